@@ -0,0 +1,88 @@
+//accuracyReport.cpp
+//
+//Differences between a run and a float64 reference run
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "accuracyReport.h"
+
+AccuracyReport::AccuracyReport(const std::string &referenceFile, const Parameters &param)
+  : referenceFile(referenceFile), nper(param.nper), dt(param.dt)
+{
+    std::ifstream infile(referenceFile);
+    if (not infile) {
+        std::cerr << "Error: cannot read the reference results '" << referenceFile << "'.\n";
+        std::exit(1);
+    }
+    //Comment lines with a time start a snapshot, the other comments hold the parameters
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] == '#') {
+            if (line.find("t =") != std::string::npos) {
+                reference.emplace_back();
+                reference.back().reserve(param.ngrid);
+            }
+            continue;
+        }
+        double x, rho;
+        std::istringstream values(line);
+        if (reference.empty() or not (values >> x >> rho)) {
+            std::cerr << "Error: '" << referenceFile << "' is not in the text output format.\n";
+            std::exit(1);
+        }
+        reference.back().push_back(rho);
+    }
+    for (const std::vector<double> &snapshot : reference) {
+        if (snapshot.size() != param.ngrid) {
+            std::cerr << "Error: the reference results '" << referenceFile << "' hold " << snapshot.size()
+                      << " points per snapshot instead of " << param.ngrid << ".\n";
+            std::exit(1);
+        }
+    }
+}
+
+void AccuracyReport::compare(size_t step, const Field &rho){
+    if (step%nper != 0 or step/nper >= reference.size()) {
+        return;
+    }
+    const std::vector<double> &expected = reference[step/nper];
+    Difference difference;
+    difference.step = step;
+    double largest = 0.0;
+    double squares = 0.0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        double error = std::fabs(rho[i] - expected[i]);
+        difference.maxAbs = std::max(difference.maxAbs, error);
+        largest = std::max(largest, std::fabs(expected[i]));
+        squares += error*error;
+    }
+    difference.relative = (largest > 0.0) ? difference.maxAbs/largest : 0.0;
+    difference.rms = std::sqrt(squares/static_cast<double>(expected.size()));
+    differences.push_back(difference);
+}
+
+void AccuracyReport::print(std::ostream &out) const{
+    out << "Accuracy against '" << referenceFile << "': ";
+    if (differences.empty()) {
+        out << "no snapshot compared.\n";
+        return;
+    }
+    auto byMaxAbs = [](const Difference &l, const Difference &r) { return l.maxAbs < r.maxAbs; };
+    auto byRelative = [](const Difference &l, const Difference &r) { return l.relative < r.relative; };
+    auto byRms = [](const Difference &l, const Difference &r) { return l.rms < r.rms; };
+    const Difference &maxAbs = *std::max_element(differences.begin(), differences.end(), byMaxAbs);
+    const Difference &relative = *std::max_element(differences.begin(), differences.end(), byRelative);
+    const Difference &rms = *std::max_element(differences.begin(), differences.end(), byRms);
+    out << differences.size() << " snapshots compared\n";
+    out << "  max abs error  " << maxAbs.maxAbs << " at t = " << static_cast<double>(maxAbs.step)*dt << "\n";
+    out << "  max rel error  " << relative.relative << " at t = " << static_cast<double>(relative.step)*dt << "\n";
+    out << "  max rms error  " << rms.rms << " at t = " << static_cast<double>(rms.step)*dt << "\n";
+    out << "  final abs error " << differences.back().maxAbs << " at t = "
+        << static_cast<double>(differences.back().step)*dt << "\n";
+}
@@ -0,0 +1,40 @@
+#ifndef ACCURACYREPORT_H
+#define ACCURACYREPORT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+
+//Compares the snapshots of a run with those of a float64 reference run stored in the text format,
+//e.g. originalResults.dat, to judge whether a reduced precision is good enough for a workload.
+//Note that the default text output keeps 6 significant digits, so differences below about 1e-6 of
+//the amplitude are within the rounding of the reference itself.
+class AccuracyReport {
+  public:
+    //Reads the reference snapshots; exits if the file cannot be read or its grid differs from ngrid points
+    AccuracyReport(const std::string &referenceFile, const Parameters &param);
+
+    //Compares the wave at the given step with the reference snapshot of the same time, if there is one
+    void compare(size_t step, const Field &rho);
+
+    //Writes the largest absolute, relative and root mean square differences and where they occur
+    void print(std::ostream &out) const;
+
+  private:
+    struct Difference {
+        size_t step = 0;
+        double maxAbs = 0.0;        // largest |rho - reference| over the grid
+        double relative = 0.0;      // maxAbs divided by the largest |reference|
+        double rms = 0.0;           // root mean square of rho - reference
+    };
+
+    std::string referenceFile;
+    size_t nper;
+    double dt;
+    std::vector<std::vector<double>> reference;   // rho of every reference snapshot, in order
+    std::vector<Difference> differences;
+};
+
+#endif
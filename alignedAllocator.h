@@ -0,0 +1,63 @@
+#ifndef ALIGNEDALLOCATOR_H
+#define ALIGNEDALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//Minimal allocator for std::vector that places the data on an Alignment-byte boundary,
+//so that the vectorized stencil kernels can use aligned stores
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator {
+  public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+    T* allocate(size_t n){
+        // aligned_alloc requires the size to be a multiple of the alignment
+        size_t bytes = ((n*sizeof(T) + Alignment - 1)/Alignment)*Alignment;
+        if (void* p = std::aligned_alloc(Alignment, bytes == 0 ? Alignment : bytes)) {
+            return static_cast<T*>(p);
+        }
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T* p, size_t) noexcept{
+        std::free(p);
+    }
+
+    //Default-initializes instead of zeroing when a vector grows without a given value, e.g. Field(n),
+    //so that the first write, possibly from several threads, is the first touch of the pages
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value){
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args){
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &){
+    return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &){
+    return false;
+}
+
+#endif
@@ -0,0 +1,122 @@
+//asyncSnapshotWriter.cpp
+//
+//Background thread that writes snapshots while the solver continues
+#include <algorithm>
+#include "asyncSnapshotWriter.h"
+
+AsyncSnapshotWriter::AsyncSnapshotWriter(std::unique_ptr<SnapshotWriter> writer, size_t nbuffers)
+  : writer(std::move(writer)), nbuffers(std::max<size_t>(nbuffers, 1))
+{}
+
+AsyncSnapshotWriter::~AsyncSnapshotWriter(){
+    if (thread.joinable()) {
+        close();
+    }
+}
+
+void AsyncSnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    writer->writeHeader(param, x);
+    // The queue never holds more entries than there are buffers, so nothing grows after this
+    pool.assign(nbuffers, Field(param.ngrid, 0));
+    for (Field &buffer : pool) {
+        freeBuffers.push_back(&buffer);
+    }
+    thread = std::thread(&AsyncSnapshotWriter::drain, this);
+}
+
+//Gives a free buffer, waiting until the writer thread returns one if there is none
+Field* AsyncSnapshotWriter::takeBuffer(){
+    // Backpressure: wait until the writer thread has returned a buffer
+    std::unique_lock<std::mutex> lock(mutex);
+    bufferFreed.wait(lock, [this] { return not freeBuffers.empty(); });
+    Field* buffer = freeBuffers.back();
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+void AsyncSnapshotWriter::enqueue(size_t step, Field* buffer){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({step, buffer});
+    }
+    snapshotQueued.notify_one();
+}
+
+void AsyncSnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    Field* buffer = takeBuffer();
+    std::copy(rho.begin(), rho.end(), buffer->begin());
+    enqueue(step, buffer);
+}
+
+void AsyncSnapshotWriter::writeSelection(size_t step, const Field &rho, size_t first, size_t stride){
+    Field* buffer = takeBuffer();
+    const double* source = rho.data() + first;
+    double* target = buffer->data();
+    const size_t count = buffer->size();
+    for (size_t i = 0; i < count; i++) {
+        target[i] = source[i*stride];
+    }
+    enqueue(step, buffer);
+}
+
+void AsyncSnapshotWriter::drain(){
+    while (true) {
+        Pending pending;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            snapshotQueued.wait(lock, [this] { return closing or not queue.empty(); });
+            if (queue.empty()) {
+                return;  // closing and everything written
+            }
+            pending = queue.front();
+            queue.pop_front();
+        }
+        writer->writeSnapshot(pending.step, *pending.buffer);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBuffers.push_back(pending.buffer);
+        }
+        bufferFreed.notify_one();
+    }
+}
+
+void AsyncSnapshotWriter::close(){
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        snapshotQueued.notify_one();
+        thread.join();
+    }
+    writer->close();
+}
+
+uint64_t AsyncSnapshotWriter::flush(){
+    {
+        // Every buffer is back once the last queued snapshot is written
+        std::unique_lock<std::mutex> lock(mutex);
+        bufferFreed.wait(lock, [this] { return freeBuffers.size() == pool.size(); });
+    }
+    return writer->flush();
+}
+
+void AsyncSnapshotWriter::resume(uint64_t size, uint64_t nsnapshots){
+    writer->resume(size, nsnapshots);
+}
+
+size_t AsyncSnapshotWriter::queueDepth(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+std::unique_ptr<SnapshotWriter> writeInBackground(std::unique_ptr<SnapshotWriter> writer, const std::string &format,
+                                                  size_t nbuffers){
+    if (nbuffers == 0 and format == "compressed") {
+        nbuffers = compressedAsyncBuffers;
+    }
+    if (not writer or nbuffers == 0) {
+        return writer;
+    }
+    return std::make_unique<AsyncSnapshotWriter>(std::move(writer), nbuffers);
+}
@@ -0,0 +1,77 @@
+#ifndef ASYNCSNAPSHOTWRITER_H
+#define ASYNCSNAPSHOTWRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wave1d.h"
+#include "snapshotWriter.h"
+
+//Passes snapshots on to another writer on a background thread, so the solver can keep stepping while
+//the data is formatted and written. Each snapshot is copied into one of a fixed pool of buffers and
+//queued; when all buffers are waiting to be written, writeSnapshot blocks until the writer thread
+//frees one, which bounds the memory used when the output cannot keep up.
+class AsyncSnapshotWriter : public SnapshotWriter {
+  public:
+    AsyncSnapshotWriter(std::unique_ptr<SnapshotWriter> writer, size_t nbuffers);
+    ~AsyncSnapshotWriter() override;
+
+    //Writes the header synchronously, allocates the buffers and starts the writer thread
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+
+    //Copies rho into a free buffer and queues it, waiting for a free buffer if there is none
+    void writeSnapshot(size_t step, const Field &rho) override;
+
+    //Like writeSnapshot, but gathers the points first + i*stride of rho for every point of the header's
+    //grid straight into the free buffer, e.g. for a RegionSnapshotWriter in front of this one
+    void writeSelection(size_t step, const Field &rho, size_t first, size_t stride);
+
+    //Waits until all queued snapshots are written, then closes the underlying writer
+    void close() override;
+
+    //Waits until all queued snapshots are written, then flushes the underlying writer
+    uint64_t flush() override;
+
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+    //Number of snapshots queued but not yet written
+    size_t queueDepth();
+
+  private:
+    struct Pending {
+        size_t step;
+        Field* buffer;
+    };
+
+    Field* takeBuffer();
+    void enqueue(size_t step, Field* buffer);
+    void drain();
+
+    std::unique_ptr<SnapshotWriter> writer;
+    size_t nbuffers;
+    std::vector<Field> pool;
+    std::vector<Field*> freeBuffers;
+    std::deque<Pending> queue;
+    std::mutex mutex;
+    std::condition_variable bufferFreed;
+    std::condition_variable snapshotQueued;
+    bool closing = false;
+    std::thread thread;
+};
+
+//Snapshots of the compressed format in flight when no number of buffers is asked for, since compression
+//should never hold up the stepping
+const size_t compressedAsyncBuffers = 2;
+
+//Wraps a writer of the given format in an AsyncSnapshotWriter with nbuffers buffers, or for the
+//compressed format with compressedAsyncBuffers if nbuffers is 0; other writers are returned as they are
+//when nbuffers is 0. This is how wave1d opens the output of a single run and of every sweep case.
+std::unique_ptr<SnapshotWriter> writeInBackground(std::unique_ptr<SnapshotWriter> writer, const std::string &format,
+                                                  size_t nbuffers);
+
+#endif
@@ -0,0 +1,961 @@
+//benchmark.cpp
+//
+//Measures the cost of the time stepping in wave1d, including the number of heap allocations per step
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include "wave1d.h"
+#include "stencilKernel.h"
+#include "simdKernels.h"
+#include "threadedStepping.h"
+#include "temporalBlocking.h"
+#include "ensembleKernel.h"
+#include "steppingEngine.h"
+#include "snapshotWriter.h"
+#include "snapshotCodecs.h"
+#include "parameterParser.h"
+#include "simulation.h"
+
+//Counts every call to the global operator new, so allocations inside the measured region become visible
+static size_t allocationCount = 0;
+
+void* operator new(size_t size){
+    allocationCount++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+    std::free(p);
+}
+
+//Sets up parameters for a run with ngrid points and nsteps time steps, writing nsnap snapshots
+static Parameters benchmarkParameters(size_t ngrid, size_t nsteps, size_t nsnap){
+    Parameters param;
+    param.c       = 1.0;
+    param.tau     = 20.0;
+    param.x1      = -26.0;
+    param.x2      = 26.0;
+    param.dx      = (param.x2-param.x1)/static_cast<double>(ngrid);
+    param.runtime = static_cast<double>(nsteps)*0.5*param.dx/param.c;
+    param.outtime = param.runtime/static_cast<double>(nsnap);
+    param.outfilename = "benchmark.dat";
+    deriveParameters(param);
+    param.ngrid = ngrid;  // guard against rounding down in deriveParameters
+    return param;
+}
+
+//Times the stepping loop alone and counts its allocations
+static void benchmarkTimeStep(size_t ngrid, size_t nsteps){
+    Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+
+    // Setup, allocations in here are not counted
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    Field rho_prev (rho);
+    Field rho_next (param.ngrid, 0);
+    StencilKernel kernel(param);
+
+    // Measured region
+    size_t allocationsBefore = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t s = 0; s < param.nsteps; s++) {
+        timeStep(rho, rho_prev, rho_next, kernel);
+        rotateBuffers(rho_prev, rho, rho_next);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    size_t allocations = allocationCount - allocationsBefore;
+
+    double seconds = std::chrono::duration<double>(stop-start).count();
+    double steps = static_cast<double>(param.nsteps);
+    std::cout << "ngrid                 " << param.ngrid << "\n";
+    std::cout << "nsteps                " << param.nsteps << "\n";
+    std::cout << "time per step (ms)    " << 1e3*seconds/steps << "\n";
+    std::cout << "ns per point per step " << 1e9*seconds/(steps*static_cast<double>(param.ngrid)) << "\n";
+    std::cout << "allocations per step  " << static_cast<double>(allocations)/steps << "\n";
+    std::cout << "checksum              " << rho[param.ngrid/2] << "\n";
+}
+
+//Times the compile-time specialized stencil for a grid size of N points
+template <bool Damped, size_t N>
+static void benchmarkFixedSize(size_t nsteps){
+    Parameters param = benchmarkParameters(N, nsteps, 1);
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    Field rho_prev (rho);
+    Field rho_next (param.ngrid, 0);
+    StencilKernel kernel(param);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t s = 0; s < param.nsteps; s++) {
+        applyStencil<Damped, N>(kernel, rho.data(), rho_prev.data(), rho_next.data());
+        rotateBuffers(rho_prev, rho, rho_next);
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(stop-start).count();
+    double steps = static_cast<double>(param.nsteps);
+    std::cout << "fixed size " << N << (Damped ? " damped   " : " undamped ")
+              << 1e9*seconds/(steps*static_cast<double>(N)) << " ns per point per step\n";
+}
+
+//Times every stencil implementation available on this CPU and compares its result with the scalar reference
+static void benchmarkSimdLevels(size_t ngrid, size_t nsteps){
+    Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+    UniformGrid x = initializeX(param);
+    StencilKernel kernel(param);
+    Field reference;
+    SimdLevel detected = detectSimdLevel();
+    for (SimdLevel level : {SimdLevel::scalar, SimdLevel::avx2, SimdLevel::avx512, SimdLevel::neon}) {
+        if (level != SimdLevel::scalar and stencilFunction(level) == stencilFunction(SimdLevel::scalar)) {
+            continue;  // not available on this CPU
+        }
+        selectSimdLevel(level);
+        Field rho = initializeRho(param, x);
+        Field rho_prev (rho);
+        Field rho_next (param.ngrid, 0);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < param.nsteps; s++) {
+            timeStep(rho, rho_prev, rho_next, kernel);
+            rotateBuffers(rho_prev, rho, rho_next);
+        }
+        auto stop = std::chrono::steady_clock::now();
+        if (level == SimdLevel::scalar) {
+            reference = rho;
+        }
+        double maxdiff = 0.0;
+        for (size_t i = 0; i < param.ngrid; i++) {
+            maxdiff = std::fmax(maxdiff, std::fabs(rho[i] - reference[i]));
+        }
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        std::cout << "simd " << simdLevelName(level) << (level == detected ? " (detected) " : " ")
+                  << 1e9*seconds/(static_cast<double>(param.nsteps)*static_cast<double>(param.ngrid))
+                  << " ns per point per step, max difference to scalar " << maxdiff << "\n";
+    }
+    selectSimdLevel(detected);
+}
+
+//Compares temporally blocked stepping with plain stepping for several numbers of steps per tile
+static void benchmarkTiled(size_t ngrid, size_t nsteps){
+    Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+    UniformGrid x = initializeX(param);
+    StencilKernel kernel(param);
+    Field reference;
+    for (size_t tileSteps : {size_t(1), size_t(8), size_t(32), size_t(128)}) {
+        Field rho = initializeRho(param, x);
+        Field rho_prev (rho);
+        Field rho_next (param.ngrid, 0);
+        auto start = std::chrono::steady_clock::now();
+        if (tileSteps == 1) {
+            for (size_t s = 0; s < param.nsteps; s++) {
+                timeStep(rho, rho_prev, rho_next, kernel);
+                rotateBuffers(rho_prev, rho, rho_next);
+            }
+            reference = rho;
+        } else {
+            evolveTiled(rho, rho_prev, rho_next, kernel, param.nsteps, param.nsteps+1,
+                        defaultTilePoints, tileSteps, 1, [](size_t) {});
+        }
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        std::cout << "tile steps " << tileSteps << "  "
+                  << 1e9*seconds/(static_cast<double>(param.nsteps)*static_cast<double>(param.ngrid))
+                  << " ns per point per step, identical " << (rho == reference ? "yes" : "no") << "\n";
+    }
+}
+
+//Time per member point and step of the ensemble kernel for several ensemble sizes, against single runs
+static void benchmarkEnsemble(size_t ngrid, size_t nsteps){
+    for (size_t M : {size_t(1), size_t(4), size_t(8), size_t(16)}) {
+        std::vector<Parameters> params;
+        for (size_t m = 0; m < M; m++) {
+            Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+            param.tau = 10.0 + static_cast<double>(m);
+            params.push_back(param);
+        }
+        EnsembleKernel kernel(params);
+        Field rho (ngrid*M, 0.0);
+        Field rho_prev (ngrid*M, 0.0);
+        Field rho_next (ngrid*M, 0.0);
+        UniformGrid x = initializeX(params[0]);
+        for (size_t m = 0; m < M; m++) {
+            Field initial = initializeRho(params[m], x);
+            insertMember(kernel, initial, m, rho);
+            insertMember(kernel, initial, m, rho_prev);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < nsteps; s++) {
+            ensembleStep(kernel, rho.data(), rho_prev.data(), rho_next.data());
+            rotateBuffers(rho_prev, rho, rho_next);
+        }
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        std::cout << "ensemble " << M << "  "
+                  << 1e9*seconds/(static_cast<double>(nsteps*ngrid*M)) << " ns per member point per step\n";
+    }
+}
+
+//Strong scaling of the threaded stepping: fixed problem size, doubling thread counts up to the number of cores
+static void benchmarkScaling(size_t ngrid, size_t nsteps){
+    Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+    UniformGrid x = initializeX(param);
+    StencilKernel kernel(param);
+    int maxthreads = omp_get_num_procs();
+    double serialSeconds = 0.0;
+    std::cout << "threads  time(s)  speedup  efficiency\n";
+    for (int nthreads = 1; ; nthreads = (2*nthreads < maxthreads) ? 2*nthreads : maxthreads) {
+        Field rho = initializeRho(param, x);
+        Field rho_prev (rho);
+        Field rho_next (param.ngrid, 0);
+        auto start = std::chrono::steady_clock::now();
+        evolveThreaded(rho, rho_prev, rho_next, kernel, param.nsteps, param.nsteps+1, nthreads, [](size_t) {});
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        if (nthreads == 1) {
+            serialSeconds = seconds;
+        }
+        double speedup = serialSeconds/seconds;
+        std::cout << nthreads << "  " << seconds << "  " << speedup << "  " << speedup/nthreads << "\n";
+        if (nthreads == maxthreads) {
+            break;
+        }
+    }
+}
+
+//Throughput of each snapshot writer in MB/s of output, writing nsnap snapshots of an ngrid-point wave
+static void benchmarkWriters(size_t ngrid, size_t nsnap){
+    Parameters param = benchmarkParameters(ngrid, nsnap, 1);
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    for (const char* format : {"text-stream", "text", "binary", "mapped", "compressed"}) {
+        OutputOptions options;
+        options.format = format;
+        std::unique_ptr<SnapshotWriter> writer = makeSnapshotWriter(options, param.outfilename);
+        auto start = std::chrono::steady_clock::now();
+        writer->writeHeader(param, x);
+        for (size_t n = 0; n < nsnap; n++) {
+            writer->writeSnapshot(n, rho);
+        }
+        writer->close();
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        double megabytes = static_cast<double>(std::filesystem::file_size(param.outfilename))/1e6;
+        std::cout << "writer " << format << "  " << megabytes/seconds << " MB/s\n";
+        std::remove(param.outfilename.c_str());
+    }
+}
+
+//Largest round-trip error of a codec on n values, or infinity if the encoding does not decode
+static double codecError(const SnapshotCodec &codec, const double* values, size_t n,
+                         std::vector<unsigned char> &encoded){
+    std::vector<double> decoded(n);
+    codec.encode(values, n, encoded);
+    if (not codec.decode(encoded.data(), encoded.size(), decoded.data(), n)) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double maxerror = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        bool same = std::memcmp(&decoded[i], &values[i], sizeof(double)) == 0;
+        maxerror = std::fmax(maxerror, same ? 0.0 : std::fabs(decoded[i] - values[i]));
+        if (not same and not std::isfinite(values[i])) {
+            maxerror = std::numeric_limits<double>::infinity();
+        }
+    }
+    return maxerror;
+}
+
+//Compression ratio, throughput and round-trip error of each codec on a wave evolved for nsteps steps,
+//and the error of the lossy codec on values placed to defeat its rounding; returns false if any error
+//exceeds the tolerance (lossless: any error at all)
+static bool benchmarkCodecs(size_t ngrid, size_t nsteps){
+    Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    Field rho_prev (rho);
+    Field rho_next (param.ngrid, 0);
+    StencilKernel kernel(param);
+    for (size_t s = 0; s < param.nsteps; s++) {
+        timeStep(rho, rho_prev, rho_next, kernel);
+        rotateBuffers(rho_prev, rho, rho_next);
+    }
+    const double tolerance = 1e-6;
+    bool passed = true;
+    std::vector<unsigned char> encoded;
+    for (const char* name : {"lossless", "lossy"}) {
+        std::unique_ptr<SnapshotCodec> codec = makeSnapshotCodec(name, tolerance);
+        auto start = std::chrono::steady_clock::now();
+        codec->encode(rho.data(), param.ngrid, encoded);
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        double ratio = static_cast<double>(8*param.ngrid)/static_cast<double>(encoded.size());
+        double maxerror = codecError(*codec, rho.data(), param.ngrid, encoded);
+        bool within = (std::string(name) == "lossless") ? maxerror == 0.0 : maxerror <= tolerance;
+        passed = passed and within;
+        std::cout << "codec " << name << "  ratio " << ratio << "  " << static_cast<double>(8*param.ngrid)/seconds/1e6
+                  << " MB/s  max error " << maxerror << (within ? "" : "  FAILED") << "\n";
+    }
+
+    // Values at half-steps, random values at a tolerance near the rounding error of the division, and
+    // magnitudes beyond the integer range of the multiples, with and without the non-finite values
+    const size_t n = 1000000;
+    const double halfStep = 2.0*tolerance*(1.0 - 1e-12);
+    struct { const char* name; double tolerance; std::vector<double> values; } cases[4];
+    cases[0] = {"half-steps", tolerance, std::vector<double>(n)};
+    cases[1] = {"random-1e-12", 1e-12, std::vector<double>(n)};
+    cases[2] = {"large", tolerance, std::vector<double>(n)};
+    cases[3] = {"non-finite", tolerance, {std::numeric_limits<double>::infinity(),
+                                          -std::numeric_limits<double>::infinity(),
+                                          std::numeric_limits<double>::quiet_NaN(), 0.0, 1e300, -1e300}};
+    uint64_t state = 88172645463325252ull;  // xorshift, for reproducible values without <random>
+    auto uniform = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<double>(state >> 11)*0x1p-53;
+    };
+    for (size_t i = 0; i < n; i++) {
+        double k = std::floor((uniform() - 0.5)*0.5/halfStep);
+        cases[0].values[i] = (k + 0.5)*halfStep;
+        cases[1].values[i] = (uniform() - 0.5)*0.5;
+        cases[2].values[i] = (uniform() - 0.5)*std::ldexp(1.0, static_cast<int>(i%80));
+    }
+    for (const auto &c : cases) {
+        LossyCodec codec(c.tolerance);
+        double maxerror = codecError(codec, c.values.data(), c.values.size(), encoded);
+        bool within = maxerror <= c.tolerance;
+        passed = passed and within;
+        std::cout << "codec lossy " << c.name << "  tolerance " << c.tolerance << "  max error " << maxerror
+                  << (within ? "" : "  FAILED") << "\n";
+    }
+    return passed;
+}
+
+//Replicates the full run of wave1d including snapshot output and counts the allocations after setup,
+//which must not grow with the number of steps or snapshots
+static void benchmarkFullRun(size_t ngrid, size_t nsteps, size_t nsnap){
+    Parameters param = benchmarkParameters(ngrid, nsteps, nsnap);
+    std::ofstream fout(param.outfilename);
+    writeParameters(param, fout);
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    Field rho_prev (rho);
+    Field rho_next (param.ngrid, 0);
+    fout << "\n#t = " << 0.0 << "\n";
+    printX(fout, rho, x, param);
+
+    size_t allocationsBefore = allocationCount;
+    for (size_t s = 0; s < param.nsteps; s++) {
+        timeStep(rho, rho_prev, rho_next, param);
+        rotateBuffers(rho_prev, rho, rho_next);
+        if ((s+1)%param.nper == 0) {
+            fout << "\n\n# t = " << static_cast<double>(s+1)*param.dt << "\n";
+            printX(fout, rho, x, param);
+        }
+    }
+    fout.close();
+    size_t allocations = allocationCount - allocationsBefore;
+
+    std::cout << "full run snapshots    " << param.nsteps/param.nper << "\n";
+    std::cout << "full run allocations  " << allocations << "\n";
+    std::remove(param.outfilename.c_str());
+}
+
+//One measurement of the benchmark suite
+struct SuiteResult {
+    std::string name;       // what was measured, e.g. step/serial/1000000
+    std::string unit;
+    double value;
+    bool lowerIsBetter;
+};
+
+//Bandwidth of the STREAM triad a = b + s*c in GB/s, the practical limit of the stencil, best of five
+static double streamTriad(size_t n){
+    Field a(n, 0.0), b(n, 1.0), c(n, 2.0);
+    double best = 0.0;
+    for (int repeat = 0; repeat < 5; repeat++) {
+        auto start = std::chrono::steady_clock::now();
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; i++) {
+            a[i] = b[i] + 3.0*c[i];
+        }
+        auto stop = std::chrono::steady_clock::now();
+        best = std::fmax(best, 24.0*static_cast<double>(n)/std::chrono::duration<double>(stop-start).count()/1e9);
+    }
+    return best + 0.0*a[n/2];  // reading a keeps the loop from being optimized away
+}
+
+//Steps a fresh wave with the given engine and stencil order; adds ns per point per step, GB/s (24 bytes per
+//point per step for the two levels read and the one written) and the allocations per step to results
+static void suiteStep(const std::string &name, SteppingEngine &engine, size_t ngrid, double stream,
+                      std::vector<SuiteResult> &results, size_t elementSize = sizeof(double), size_t order = 2){
+    // Keep the work per measurement near 5e7 point-steps, but stop small grids before the damped wave
+    // decays into subnormal numbers, which happens much earlier in float
+    size_t nsteps = std::clamp<size_t>(50000000/ngrid, 10, elementSize < sizeof(double) ? 2000 : 20000);
+    Parameters param = benchmarkParameters(ngrid, nsteps, 1);
+    param.order = order;
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    Field rho_prev (rho);
+    engine.init(StencilKernel(param), std::move(rho), std::move(rho_prev), 0);
+
+    engine.step(1);  // warm up
+    size_t allocationsBefore = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+    engine.step(param.nsteps);
+    auto stop = std::chrono::steady_clock::now();
+    size_t allocations = allocationCount - allocationsBefore;
+
+    double pointSteps = static_cast<double>(param.nsteps)*static_cast<double>(ngrid);
+    double seconds = std::chrono::duration<double>(stop-start).count();
+    double bandwidth = 3.0*static_cast<double>(elementSize)*pointSteps/seconds/1e9;
+    std::string key = "step/" + name + "/" + std::to_string(ngrid);
+    results.push_back({key, "ns/point/step", 1e9*seconds/pointSteps, true});
+    results.push_back({key + "/bandwidth", "GB/s", bandwidth, false});
+    results.push_back({key + "/stream-fraction", "", bandwidth/stream, false});
+    results.push_back({key + "/allocations", "per step", static_cast<double>(allocations)/static_cast<double>(param.nsteps), true});
+}
+
+//Time per point of initializeRho
+static void suiteInitialize(size_t ngrid, std::vector<SuiteResult> &results){
+    Parameters param = benchmarkParameters(ngrid, 1, 1);
+    UniformGrid x = initializeX(param);
+    auto start = std::chrono::steady_clock::now();
+    Field rho = initializeRho(param, x);
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop-start).count();
+    results.push_back({"initializeRho/" + std::to_string(ngrid), "ns/point",
+                       1e9*seconds/static_cast<double>(ngrid) + 0.0*rho[ngrid/2], true});  // as in streamTriad
+}
+
+//Output rate of the text and binary writers
+static void suiteWriters(size_t ngrid, size_t nsnap, std::vector<SuiteResult> &results){
+    Parameters param = benchmarkParameters(ngrid, nsnap, 1);
+    UniformGrid x = initializeX(param);
+    Field rho = initializeRho(param, x);
+    for (const char* format : {"text-stream", "text", "binary"}) {
+        OutputOptions options;
+        options.format = format;
+        std::unique_ptr<SnapshotWriter> writer = makeSnapshotWriter(options, param.outfilename);
+        auto start = std::chrono::steady_clock::now();
+        writer->writeHeader(param, x);
+        for (size_t n = 0; n < nsnap; n++) {
+            writer->writeSnapshot(n, rho);
+        }
+        writer->close();
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        double megabytes = static_cast<double>(std::filesystem::file_size(param.outfilename))/1e6;
+        results.push_back({std::string("writer/") + format, "MB/s", megabytes/seconds, false});
+        std::remove(param.outfilename.c_str());
+    }
+}
+
+//Time to read and check a parameter file
+static void suiteReadFile(std::vector<SuiteResult> &results){
+    const std::string filename = "benchmark_params.txt";
+    std::ofstream(filename) << "1.0\n20.0\n-26.0\n26.0\n100.0\n1.0\n1.0\nresults.dat\n# comment\n";
+    const int nreads = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < nreads; n++) {
+        Parameters param = readFile(filename);
+        deriveParameters(param);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    std::remove(filename.c_str());
+    results.push_back({"readFile", "us", 1e6*std::chrono::duration<double>(stop-start).count()/nreads, true});
+
+    // A batch of key=value runs that each change c, parsed in one pass
+    std::string batch = "c = 1\ntau = 20\nx1 = -26\nx2 = 26\nruntime = 100\ndx = 1\nouttime = 1\nfilename = results.dat\n";
+    for (int n = 1; n < nreads; n++) {
+        batch += "---\nc = " + std::to_string(1.0 + 0.001*n) + "\n";
+    }
+    std::vector<Parameters> params;
+    ParameterError error;
+    start = std::chrono::steady_clock::now();
+    parseParameterBatch(batch, params, error);
+    stop = std::chrono::steady_clock::now();
+    results.push_back({"parseParameterBatch", "us per run",
+                       1e6*std::chrono::duration<double>(stop-start).count()/nreads, true});
+}
+
+//Writes the results as JSON, one result per line
+static void writeSuiteJson(const std::string &filename, double stream, const std::vector<SuiteResult> &results){
+    std::ofstream fout(filename);
+    fout << "{\n  \"stream_triad_gbs\": " << stream << ",\n  \"simd\": \"" << simdLevelName(selectedSimdLevel())
+         << "\",\n  \"threads\": " << omp_get_max_threads() << ",\n  \"results\": [\n";
+    for (size_t n = 0; n < results.size(); n++) {
+        const SuiteResult &r = results[n];
+        fout << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"value\": " << r.value
+             << ", \"lower_is_better\": " << (r.lowerIsBetter ? "true" : "false") << "}"
+             << (n+1 < results.size() ? "," : "") << "\n";
+    }
+    fout << "  ]\n}\n";
+}
+
+//Reads name and value of each result from a file written by writeSuiteJson
+static std::map<std::string, double> readSuiteJson(const std::string &filename){
+    std::map<std::string, double> values;
+    std::ifstream fin(filename);
+    if (not fin) {
+        std::cerr << "Error: cannot read baseline '" << filename << "'.\n";
+        std::exit(1);
+    }
+    std::string line;
+    while (std::getline(fin, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t value = line.find("\"value\": ");
+        if (name == std::string::npos or value == std::string::npos) {
+            continue;
+        }
+        name += 9;
+        values[line.substr(name, line.find('"', name) - name)] = std::strtod(line.c_str() + value + 9, nullptr);
+    }
+    return values;
+}
+
+//The suite for dashboards: stepping with every engine (and the serial engine at every instruction set, in
+//float32 and mixed precision and with the stencils of order 4 and 6) over ngrid = 1e2 .. maxngrid,
+//initializeRho, the writers, readFile and parseParameterBatch. Results go to stdout and, if given, to
+//jsonFile. With a baseline file, returns 1 if any result is worse than the baseline by more than tolerance.
+static int benchmarkSuite(size_t maxngrid, const std::string &jsonFile, const std::string &baseline, double tolerance){
+    std::vector<SuiteResult> results;
+    double stream = streamTriad(size_t(1) << 24);
+    std::cout << "stream triad  " << stream << " GB/s\n";
+
+    SimdLevel detected = selectedSimdLevel();
+    for (size_t ngrid = 100; ngrid <= maxngrid; ngrid *= 10) {
+        for (const std::string &name : engineNames()) {
+            std::unique_ptr<SteppingEngine> engine = makeEngine(name, EngineOptions());
+            if (engine) {
+                suiteStep(name, *engine, ngrid, stream, results);
+            }
+        }
+        for (SimdLevel level : {SimdLevel::scalar, SimdLevel::avx2, SimdLevel::avx512, SimdLevel::neon}) {
+            if (level != SimdLevel::scalar and stencilFunction(level) == stencilFunction(SimdLevel::scalar)) {
+                continue;  // not available on this CPU
+            }
+            selectSimdLevel(level);
+            std::unique_ptr<SteppingEngine> engine = makeEngine("serial", EngineOptions());
+            suiteStep(std::string("serial-") + simdLevelName(level), *engine, ngrid, stream, results);
+        }
+        selectSimdLevel(detected);
+        for (Precision precision : {Precision::float32, Precision::mixed}) {
+            EngineOptions options;
+            options.precision = precision;
+            std::unique_ptr<SteppingEngine> engine = makeEngine("serial", options);
+            suiteStep(std::string("serial-") + precisionName(precision), *engine, ngrid, stream, results,
+                      sizeof(float));
+        }
+        for (size_t order : {4, 6}) {
+            // The wider stencils read more neighbours, but the same three levels
+            std::unique_ptr<SteppingEngine> engine = makeEngine("serial", EngineOptions());
+            suiteStep("serial-order" + std::to_string(order), *engine, ngrid, stream, results, sizeof(double),
+                      order);
+        }
+        suiteInitialize(ngrid, results);
+    }
+    suiteWriters(100000, 20, results);
+    suiteReadFile(results);
+
+    for (const SuiteResult &r : results) {
+        std::cout << r.name << "  " << r.value << " " << r.unit << "\n";
+    }
+    if (not jsonFile.empty()) {
+        writeSuiteJson(jsonFile, stream, results);
+    }
+    if (baseline.empty()) {
+        return 0;
+    }
+
+    // Compare with the baseline, skipping results it does not have
+    int regressions = 0;
+    std::map<std::string, double> reference = readSuiteJson(baseline);
+    for (const SuiteResult &r : results) {
+        auto found = reference.find(r.name);
+        if (found == reference.end() or found->second == 0.0) {
+            continue;
+        }
+        double change = r.value/found->second - 1.0;
+        if ((r.lowerIsBetter and change > tolerance) or (not r.lowerIsBetter and change < -tolerance)) {
+            std::cout << "REGRESSION " << r.name << "  " << found->second << " -> " << r.value << " " << r.unit << "\n";
+            regressions++;
+        }
+    }
+    std::cout << regressions << " regressions beyond " << 100*tolerance << "% of '" << baseline << "'\n";
+    return (regressions > 0) ? 1 : 0;
+}
+
+//Tolerances and settings of the parity harness
+struct ParityOptions {
+    std::string paramFile = "waveparams.txt";       // the reference configuration ...
+    std::string original = "originalResults.dat";   // ... and the output of the original code for it
+    std::vector<std::string> configs;               // further parameter files
+    uint64_t ulps = 0;              // float64 values may differ by this many units in the last place ...
+    double absolute = 0.0;          // ... or by this much
+    double reducedAbsolute = 1e-3;  // float32 and mixed values may differ by this much (float32 drifts by
+                                    // about 1e-4 over the 100 steps of the large grid, see the report)
+    double slack = 0.1;             // a backend may take this fraction longer than the scalar baseline ...
+    double minSeconds = 0.01;       // ... on the configurations whose baseline takes at least this long
+    size_t repeats = 3;             // runs per backend, the fastest one counts
+    std::string jsonFile;
+};
+
+//One backend of the parity harness: a stepping engine in some precision and, for the serial engine, at
+//some instruction set
+struct ParityMode {
+    std::string name;
+    std::string engine;
+    std::string precision;
+    SimdLevel simd;
+};
+
+//A configuration the backends are compared on
+struct ParityConfig {
+    std::string name;
+    Parameters param;
+};
+
+//How one backend did on one configuration
+struct ParityResult {
+    std::string config;
+    std::string mode;
+    bool reduced = false;       // float32 or mixed, compared by the absolute difference only
+    uint64_t maxUlps = 0;
+    double maxAbs = 0.0;
+    double seconds = 0.0;
+    double speedup = 0.0;       // baseline seconds over these seconds
+    std::string verdict;        // ok, WRONG, SLOW or skipped (with the reason)
+};
+
+//Distance of two doubles in units in the last place, i.e. the number of doubles in between plus one
+static uint64_t ulpDistance(double a, double b){
+    if (a == b) {
+        return 0;   // also for +0 and -0
+    }
+    if (std::isnan(a) or std::isnan(b)) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    // Map the bit patterns to integers that are ordered like the doubles
+    auto ordered = [](double value) {
+        int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits < 0) ? std::numeric_limits<int64_t>::min() - bits : bits;
+    };
+    int64_t x = ordered(a);
+    int64_t y = ordered(b);
+    return (x > y) ? static_cast<uint64_t>(x) - static_cast<uint64_t>(y)
+                   : static_cast<uint64_t>(y) - static_cast<uint64_t>(x);
+}
+
+//The built-in configurations: the parameter file, a finer grid, a gaussian at every stencil order and a
+//large grid on which the runtimes mean something
+static std::vector<ParityConfig> parityConfigs(const ParityOptions &options){
+    std::vector<ParityConfig> configs;
+    Parameters base = readFile(options.paramFile);
+    configs.push_back({"waveparams", base});
+    Parameters fine = base;
+    fine.dx = base.dx/20.0;
+    configs.push_back({"fine", fine});
+    for (size_t order : {2, 4, 6}) {
+        Parameters gaussian = fine;
+        gaussian.initial = "gaussian";
+        gaussian.order = order;
+        gaussian.courant = (order == 2) ? 0.5 : 0.8;
+        configs.push_back({"gaussian-order" + std::to_string(order), gaussian});
+    }
+    Parameters large = base;
+    large.dx = (base.x2 - base.x1)/2e6;
+    large.runtime = 100.5*0.5*large.dx/large.c;
+    large.outtime = 25.0*0.5*large.dx/large.c;
+    configs.push_back({"large", large});
+    for (const std::string &file : options.configs) {
+        configs.push_back({std::filesystem::path(file).stem().string(), readFile(file)});
+    }
+    for (ParityConfig &config : configs) {
+        config.param.engine.clear();
+        config.param.precision.clear();
+        deriveParameters(config.param);
+    }
+    return configs;
+}
+
+//The scalar serial baseline first, then the serial engine at the other instruction sets, the other
+//engines and the reduced precisions
+static std::vector<ParityMode> parityModes(){
+    const SimdLevel detected = selectedSimdLevel();
+    std::vector<ParityMode> modes = {{"serial-scalar", "serial", "float64", SimdLevel::scalar}};
+    for (SimdLevel level : {SimdLevel::avx2, SimdLevel::avx512, SimdLevel::neon}) {
+        if (stencilFunction(level) != stencilFunction(SimdLevel::scalar)) {
+            modes.push_back({std::string("serial-") + simdLevelName(level), "serial", "float64", level});
+        }
+    }
+    for (const std::string &name : engineNames()) {
+        if (name != "serial") {
+            modes.push_back({name, name, "float64", detected});
+        }
+    }
+    for (const char* engine : {"serial", "threaded"}) {
+        for (const char* precision : {"float32", "mixed"}) {
+            modes.push_back({std::string(engine) + "-" + precision, engine, precision, detected});
+        }
+    }
+    return modes;
+}
+
+//Runs one configuration with one backend, repeats times; returns the fastest time, or a negative one
+//with the reason in error if the backend cannot run it. The snapshots of every run go to snapshot.
+static double parityRun(const Parameters &param, const ParityMode &mode, size_t repeats,
+                        const SnapshotCallback &snapshot, std::string &error){
+    SimulationOptions options;
+    options.engine = mode.engine;
+    options.precision = mode.precision;
+    const SimdLevel detected = selectedSimdLevel();
+    selectSimdLevel(mode.simd);
+    double best = -1.0;
+    for (size_t r = 0; r < repeats; r++) {
+        std::unique_ptr<Simulation> sim = Simulation::create(param, options, error);
+        if (not sim) {
+            break;
+        }
+        sim->onSnapshot(snapshot);
+        auto start = std::chrono::steady_clock::now();
+        if (not sim->run()) {
+            error = sim->error();
+            best = -1.0;
+            break;
+        }
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop-start).count();
+        best = (best < 0.0) ? seconds : std::min(best, seconds);
+    }
+    selectSimdLevel(detected);
+    return best;
+}
+
+//Checks that the scalar baseline still writes exactly the original output for the parameter file
+static bool parityOriginal(const ParityConfig &config, const std::vector<Field> &snapshots,
+                           const ParityOptions &options){
+    std::filesystem::path temporary = std::filesystem::temp_directory_path()/"wave1d_parity.dat";
+    {
+        std::unique_ptr<SnapshotWriter> writer = makeSnapshotWriter(OutputOptions(), temporary.string());
+        writer->writeHeader(config.param, initializeX(config.param));
+        for (size_t n = 0; n < snapshots.size(); n++) {
+            writer->writeSnapshot(n*config.param.nper, snapshots[n]);
+        }
+        writer->close();
+    }
+    std::string written, original;
+    bool same = readWholeFile(temporary.string(), written) and readWholeFile(options.original, original)
+                and written == original;
+    std::filesystem::remove(temporary);
+    return same;
+}
+
+//Writes the results as JSON, one result per line
+static void writeParityJson(const std::string &filename, const std::vector<ParityResult> &results){
+    std::ofstream fout(filename);
+    fout << "{\n  \"simd\": \"" << simdLevelName(selectedSimdLevel()) << "\",\n  \"threads\": "
+         << omp_get_max_threads() << ",\n  \"results\": [\n";
+    for (size_t n = 0; n < results.size(); n++) {
+        const ParityResult &r = results[n];
+        fout << "    {\"config\": \"" << r.config << "\", \"mode\": \"" << r.mode << "\", \"max_ulps\": "
+             << (r.reduced ? std::string("null") : std::to_string(r.maxUlps)) << ", \"max_abs\": " << r.maxAbs
+             << ", \"seconds\": " << r.seconds << ", \"speedup\": " << r.speedup << ", \"verdict\": \"" << r.verdict << "\"}"
+             << (n+1 < results.size() ? "," : "") << "\n";
+    }
+    fout << "  ]\n}\n";
+}
+
+//The parity harness: runs every backend and precision on the reference configurations and compares each
+//snapshot with the scalar serial float64 baseline, which in turn must reproduce the original output of the
+//parameter file byte for byte. A backend is WRONG if a value is off by more than the tolerances and SLOW if
+//it is slower than the baseline by more than the slack; the threaded engine is not timed when OpenMP has
+//a single thread. Returns 1 if any backend is either.
+static int benchmarkParity(const ParityOptions &options){
+    std::vector<ParityResult> results;
+    std::vector<ParityMode> modes = parityModes();
+    bool anchored = true;
+    for (const ParityConfig &config : parityConfigs(options)) {
+        const Parameters &param = config.param;
+        std::vector<Field> reference;
+        std::string error;
+        double baseline = parityRun(param, modes[0], 1, [&](size_t, const Field &rho, const Field &) {
+            reference.push_back(rho);
+        }, error);
+        if (baseline < 0.0) {
+            std::cerr << "Error: the baseline cannot run '" << config.name << "': " << error << ".\n";
+            return 1;
+        }
+        if (config.name == "waveparams") {
+            anchored = parityOriginal(config, reference, options);
+            std::cout << "the baseline " << (anchored ? "reproduces '" : "does NOT reproduce '") << options.original
+                      << "'\n";
+        }
+
+        for (const ParityMode &mode : modes) {
+            ParityResult result;
+            result.config = config.name;
+            result.mode = mode.name;
+            result.reduced = (mode.precision != "float64");
+            bool within = true;
+            size_t nsnapshots = 0;
+            auto compare = [&](size_t step, const Field &rho, const Field &) {
+                const Field &expected = reference[std::min(step/param.nper, reference.size() - 1)];
+                for (size_t i = 0; i < param.ngrid; i++) {
+                    double difference = std::fabs(rho[i] - expected[i]);
+                    result.maxAbs = std::max(result.maxAbs, difference);
+                    if (result.reduced) {
+                        within = within and difference <= options.reducedAbsolute;
+                    } else {
+                        uint64_t ulps = ulpDistance(rho[i], expected[i]);
+                        result.maxUlps = std::max(result.maxUlps, ulps);
+                        within = within and (ulps <= options.ulps or difference <= options.absolute);
+                    }
+                }
+                nsnapshots++;
+            };
+            double seconds = parityRun(param, mode, options.repeats, compare, error);
+            if (seconds < 0.0) {
+                result.verdict = "skipped: " + error;
+                results.push_back(result);
+                continue;
+            }
+            within = within and nsnapshots == reference.size()*options.repeats;
+            result.seconds = seconds;
+            result.speedup = baseline/seconds;
+            // With a single thread a threaded engine only adds its overhead, so only its results are checked
+            const bool untimed = (mode.engine == "threaded" and omp_get_max_threads() == 1);
+            const bool timed = (baseline >= options.minSeconds) and not untimed;
+            const bool slow = timed and seconds > (1.0 + options.slack)*baseline;
+            result.verdict = not within ? "WRONG" : slow ? "SLOW" : untimed ? "ok (untimed)" : "ok";
+            if (&mode == &modes[0]) {
+                baseline = seconds;  // the best of the repeats
+                result.speedup = 1.0;
+            }
+            results.push_back(result);
+        }
+    }
+
+    size_t failures = anchored ? 0 : 1;
+    std::printf("%-16s %-18s %10s %12s %11s %8s  %s\n", "config", "backend", "max ulps", "max abs", "seconds",
+                "speedup", "verdict");
+    for (const ParityResult &r : results) {
+        if (r.verdict.rfind("skipped", 0) == 0) {
+            std::printf("%-16s %-18s %10s %12s %11s %8s  %s\n", r.config.c_str(), r.mode.c_str(), "-", "-", "-", "-",
+                        r.verdict.c_str());
+            continue;
+        }
+        std::string ulps = r.reduced ? "-" : std::to_string(r.maxUlps);
+        std::printf("%-16s %-18s %10s %12.4g %11.6f %8.3f  %s\n", r.config.c_str(), r.mode.c_str(), ulps.c_str(),
+                    r.maxAbs, r.seconds, r.speedup, r.verdict.c_str());
+        failures += (r.verdict == "WRONG" or r.verdict == "SLOW") ? 1 : 0;
+    }
+    if (not options.jsonFile.empty()) {
+        writeParityJson(options.jsonFile, results);
+    }
+    std::cout << failures << " parity failures\n";
+    return (failures > 0) ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // Strong scaling mode: benchmark --scaling [ngrid] [nsteps]
+    if (argc > 1 and std::string(argv[1]) == "--scaling") {
+        size_t ngrid  = (argc > 2) ? std::stoul(argv[2]) : 10000000;
+        size_t nsteps = (argc > 3) ? std::stoul(argv[3]) : 100;
+        benchmarkScaling(ngrid, nsteps);
+        return 0;
+    }
+
+    // Suite mode: benchmark --suite [--max-ngrid=N] [--json=FILE] [--baseline=FILE] [--tolerance=FRACTION]
+    if (argc > 1 and std::string(argv[1]) == "--suite") {
+        size_t maxngrid = 100000000;
+        std::string jsonFile, baseline;
+        double tolerance = 0.2;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--max-ngrid=", 0) == 0) {
+                maxngrid = static_cast<size_t>(std::stod(arg.substr(12)));
+            } else if (arg.rfind("--json=", 0) == 0) {
+                jsonFile = arg.substr(7);
+            } else if (arg.rfind("--baseline=", 0) == 0) {
+                baseline = arg.substr(11);
+            } else if (arg.rfind("--tolerance=", 0) == 0) {
+                tolerance = std::stod(arg.substr(12));
+            } else {
+                std::cerr << "Error: unrecognized argument '" << arg << "'.\n";
+                return 1;
+            }
+        }
+        return benchmarkSuite(maxngrid, jsonFile, baseline, tolerance);
+    }
+
+    // Parity mode: benchmark --parity [--params=FILE] [--original=FILE] [--config=FILE]... [--ulps=N]
+    // [--abs=X] [--reduced-abs=X] [--slack=FRACTION] [--min-seconds=S] [--repeats=N] [--json=FILE]
+    if (argc > 1 and std::string(argv[1]) == "--parity") {
+        ParityOptions options;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--params=", 0) == 0) {
+                options.paramFile = arg.substr(9);
+            } else if (arg.rfind("--original=", 0) == 0) {
+                options.original = arg.substr(11);
+            } else if (arg.rfind("--config=", 0) == 0) {
+                options.configs.push_back(arg.substr(9));
+            } else if (arg.rfind("--ulps=", 0) == 0) {
+                options.ulps = std::stoull(arg.substr(7));
+            } else if (arg.rfind("--abs=", 0) == 0) {
+                options.absolute = std::stod(arg.substr(6));
+            } else if (arg.rfind("--reduced-abs=", 0) == 0) {
+                options.reducedAbsolute = std::stod(arg.substr(14));
+            } else if (arg.rfind("--slack=", 0) == 0) {
+                options.slack = std::stod(arg.substr(8));
+            } else if (arg.rfind("--min-seconds=", 0) == 0) {
+                options.minSeconds = std::stod(arg.substr(14));
+            } else if (arg.rfind("--repeats=", 0) == 0) {
+                options.repeats = std::max<size_t>(1, std::stoul(arg.substr(10)));
+            } else if (arg.rfind("--json=", 0) == 0) {
+                options.jsonFile = arg.substr(7);
+            } else {
+                std::cerr << "Error: unrecognized argument '" << arg << "'.\n";
+                return 1;
+            }
+        }
+        return benchmarkParity(options);
+    }
+
+    // Grid size and number of steps can be given on the command line
+    size_t ngrid  = (argc > 1) ? std::stoul(argv[1]) : 1000000;
+    size_t nsteps = (argc > 2) ? std::stoul(argv[2]) : 100;
+
+    benchmarkTimeStep(ngrid, nsteps);
+    benchmarkFixedSize<true, fixedStencilSize>(10000);
+    benchmarkFixedSize<false, fixedStencilSize>(10000);
+    benchmarkSimdLevels(ngrid, nsteps);
+    benchmarkTiled(ngrid, nsteps);
+    benchmarkEnsemble(ngrid/16, nsteps);
+    benchmarkWriters(100000, 20);
+    bool codecsPassed = benchmarkCodecs(ngrid, nsteps);
+    benchmarkFullRun(10000, 1000, 100);
+    return codecsPassed ? 0 : 1;
+}
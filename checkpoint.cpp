@@ -0,0 +1,206 @@
+//checkpoint.cpp
+//
+//Checkpoints of the full state of a run, and reading them back for a restart
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+static const char checkpointMagic[8] = {'W', 'A', 'V', 'E', 'C', 'K', 'P', 'T'};
+
+//Writes n bytes to fd, false on failure
+static bool writeAll(int fd, const void* data, size_t n){
+    const char* bytes = static_cast<const char*>(data);
+    while (n > 0) {
+        ssize_t written = ::write(fd, bytes, n);
+        if (written < 0 and errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        n -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+//Converts ngrid values to little-endian (a no-op on little-endian hosts)
+static void fieldToLittleEndian(Field &values){
+    for (double &value : values) {
+        value = toLittleEndian(value);
+    }
+}
+
+Checkpoint readCheckpoint(const std::string &filename){
+    std::ifstream fin(filename, std::ios::binary);
+    BinaryHeader header;
+    Checkpoint checkpoint;
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    // Byte swapping is its own inverse
+    header = headerToLittleEndian(header);
+    if (not fin or std::memcmp(header.magic, checkpointMagic, sizeof(checkpointMagic)) != 0
+        or header.version != binaryFormatVersion or header.elementSize != sizeof(double)) {
+        std::cerr << "Error: '" << filename << "' is not a wave1d checkpoint.\n";
+        std::exit(1);
+    }
+    Parameters &param = checkpoint.param;
+    param.c           = header.c;
+    param.tau         = header.tau;
+    param.x1          = header.x1;
+    param.x2          = header.x2;
+    param.runtime     = header.runtime;
+    param.dx          = header.dx;
+    param.outtime     = header.outtime;
+    param.outfilename = header.outfilename;
+    param.ngrid       = header.ngrid;
+    param.dt          = header.dt;
+    param.nsteps      = header.nsteps;
+    param.nper        = header.nper;
+
+    fin.read(reinterpret_cast<char*>(&checkpoint.record), sizeof(checkpoint.record));
+    checkpoint.record.step       = toLittleEndian(checkpoint.record.step);
+    checkpoint.record.outputSize = toLittleEndian(checkpoint.record.outputSize);
+    checkpoint.record.nsnapshots = toLittleEndian(checkpoint.record.nsnapshots);
+    checkpoint.record.order      = toLittleEndian(checkpoint.record.order);
+    checkpoint.record.courant    = toLittleEndian(checkpoint.record.courant);
+    checkpoint.record.float32          = toLittleEndian(checkpoint.record.float32);
+    checkpoint.record.textPrecision    = toLittleEndian(checkpoint.record.textPrecision);
+    checkpoint.record.tolerance        = toLittleEndian(checkpoint.record.tolerance);
+    checkpoint.record.compressionBlock = toLittleEndian(checkpoint.record.compressionBlock);
+    checkpoint.record.fieldEvery       = toLittleEndian(checkpoint.record.fieldEvery);
+    checkpoint.record.regionMin        = toLittleEndian(checkpoint.record.regionMin);
+    checkpoint.record.regionMax        = toLittleEndian(checkpoint.record.regionMax);
+    checkpoint.record.regionStride     = toLittleEndian(checkpoint.record.regionStride);
+    param.order       = checkpoint.record.order;
+    param.courant     = checkpoint.record.courant;
+    param.engine      = checkpoint.record.engine;
+    param.precision   = checkpoint.record.precision;
+    param.initial     = checkpoint.record.initial;
+    OutputOptions &output = checkpoint.output;
+    output.format           = checkpoint.record.format;
+    output.codec            = checkpoint.record.codec;
+    output.float32          = checkpoint.record.float32 != 0;
+    output.precision        = static_cast<int>(checkpoint.record.textPrecision);
+    output.tolerance        = checkpoint.record.tolerance;
+    output.compressionBlock = checkpoint.record.compressionBlock;
+    checkpoint.region.xmin   = checkpoint.record.regionMin;
+    checkpoint.region.xmax   = checkpoint.record.regionMax;
+    checkpoint.region.stride = checkpoint.record.regionStride;
+    checkpoint.fieldEvery    = checkpoint.record.fieldEvery;
+    checkpoint.rho.resize(param.ngrid);
+    checkpoint.rho_prev.resize(param.ngrid);
+    std::streamsize bytes = static_cast<std::streamsize>(param.ngrid*sizeof(double));
+    fin.read(reinterpret_cast<char*>(checkpoint.rho.data()), bytes);
+    fin.read(reinterpret_cast<char*>(checkpoint.rho_prev.data()), bytes);
+    if (not fin) {
+        std::cerr << "Error: checkpoint '" << filename << "' is incomplete.\n";
+        std::exit(1);
+    }
+    fieldToLittleEndian(checkpoint.rho);
+    fieldToLittleEndian(checkpoint.rho_prev);
+    return checkpoint;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &filename, const Parameters &param, const OutputOptions &output,
+                                   const OutputRegion &region, size_t fieldEvery)
+  : filename(filename), header(makeBinaryHeader(param, sizeof(double))), rho(param.ngrid), rho_prev(param.ngrid)
+{
+    std::memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+    std::memset(&record, 0, sizeof(record));
+    record.order = param.order;
+    record.courant = param.courant;
+    std::strncpy(record.engine, param.engine.c_str(), sizeof(record.engine)-1);
+    std::strncpy(record.precision, param.precision.c_str(), sizeof(record.precision)-1);
+    std::strncpy(record.initial, param.initial.c_str(), sizeof(record.initial)-1);
+    std::strncpy(record.format, output.format.c_str(), sizeof(record.format)-1);
+    std::strncpy(record.codec, output.codec.c_str(), sizeof(record.codec)-1);
+    record.float32 = output.float32 ? 1 : 0;
+    record.textPrecision = output.precision;
+    record.tolerance = output.tolerance;
+    record.compressionBlock = output.compressionBlock;
+    record.fieldEvery = fieldEvery;
+    record.regionMin = region.xmin;
+    record.regionMax = region.xmax;
+    record.regionStride = region.stride;
+    thread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+void CheckpointWriter::save(SteppingEngine &engine, uint64_t step, uint64_t outputSize, uint64_t nsnapshots){
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return not pending; });
+    engine.fetchState(rho, rho_prev);
+    record.step = step;
+    record.outputSize = outputSize;
+    record.nsnapshots = nsnapshots;
+    pending = true;
+    lock.unlock();
+    changed.notify_all();
+}
+
+void CheckpointWriter::run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return pending or stopping; });
+        if (not pending) {
+            return;  // stopping with nothing left to write
+        }
+        // The buffers are not touched by save until pending is cleared
+        lock.unlock();
+        write();
+        lock.lock();
+        pending = false;
+        changed.notify_all();
+    }
+}
+
+void CheckpointWriter::write(){
+    std::string temporary = filename + ".tmp";
+    BinaryHeader little = headerToLittleEndian(header);
+    CheckpointRecord littleRecord = record;
+    littleRecord.step       = toLittleEndian(record.step);
+    littleRecord.outputSize = toLittleEndian(record.outputSize);
+    littleRecord.nsnapshots = toLittleEndian(record.nsnapshots);
+    littleRecord.order      = toLittleEndian(record.order);
+    littleRecord.courant    = toLittleEndian(record.courant);
+    littleRecord.float32          = toLittleEndian(record.float32);
+    littleRecord.textPrecision    = toLittleEndian(record.textPrecision);
+    littleRecord.tolerance        = toLittleEndian(record.tolerance);
+    littleRecord.compressionBlock = toLittleEndian(record.compressionBlock);
+    littleRecord.fieldEvery       = toLittleEndian(record.fieldEvery);
+    littleRecord.regionMin        = toLittleEndian(record.regionMin);
+    littleRecord.regionMax        = toLittleEndian(record.regionMax);
+    littleRecord.regionStride     = toLittleEndian(record.regionStride);
+    fieldToLittleEndian(rho);
+    fieldToLittleEndian(rho_prev);
+
+    int fd = ::open(temporary.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    bool written = fd >= 0
+        and writeAll(fd, &little, sizeof(little))
+        and writeAll(fd, &littleRecord, sizeof(littleRecord))
+        and writeAll(fd, rho.data(), rho.size()*sizeof(double))
+        and writeAll(fd, rho_prev.data(), rho_prev.size()*sizeof(double))
+        and ::fsync(fd) == 0;
+    if (fd >= 0) {
+        written = (::close(fd) == 0) and written;
+    }
+    // Only a complete file replaces the previous checkpoint
+    if (not written or std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Warning: could not write checkpoint '" << filename << "': " << std::strerror(errno) << "\n";
+        std::remove(temporary.c_str());
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "wave1d.h"
+#include "snapshotWriter.h"
+#include "regionSnapshotWriter.h"
+#include "steppingEngine.h"
+
+//Layout of a checkpoint file, all values little-endian:
+//  BinaryHeader       the parameters of the run (see snapshotWriter.h), with magic "WAVECKPT"
+//  CheckpointRecord
+//  rho, rho_prev      ngrid float64 values each, exactly as they were in the engine
+struct CheckpointRecord {
+    uint64_t step;              // number of time steps taken
+    uint64_t outputSize;        // bytes of the output file written up to this step
+    uint64_t nsnapshots;        // snapshots in the output file up to this step
+    uint64_t order;             // spatial order of the stencil, see stencilKernel.h
+    double   courant;           // Courant number the time step was derived from
+    char     engine[32];        // stepping engine, precision and initial wave of the run, zero-terminated
+    char     precision[16];
+    char     initial[256];      // truncated if longer
+    char     format[16];        // snapshot output of the run, see OutputOptions and OutputRegion, zero-terminated
+    char     codec[16];
+    uint64_t float32;
+    int64_t  textPrecision;
+    double   tolerance;
+    uint64_t compressionBlock;
+    uint64_t fieldEvery;        // full snapshots at every fieldEvery-th sample
+    double   regionMin;
+    double   regionMax;
+    uint64_t regionStride;
+};
+
+//The state of an interrupted run, as read back from a checkpoint
+struct Checkpoint {
+    Parameters param;
+    CheckpointRecord record;
+    OutputOptions output;       // the options of the output file, as the run started with them
+    OutputRegion region;
+    size_t fieldEvery;
+    Field rho;
+    Field rho_prev;
+};
+
+//Reads a checkpoint written by CheckpointWriter, stops the program if the file is not a valid checkpoint
+Checkpoint readCheckpoint(const std::string &filename);
+
+//Writes checkpoints on a background thread. save copies the state of the engine into a preallocated
+//buffer and returns; the thread writes it to filename.tmp, syncs it to disk and renames it to filename,
+//so the file always holds a complete checkpoint. A save waits for the previous one to be written.
+class CheckpointWriter {
+  public:
+    //The parameters are those of the simulation (Simulation::parameters), which name its engine,
+    //precision and initial wave; the output options, region and fieldEvery are those of its output file
+    CheckpointWriter(const std::string &filename, const Parameters &param, const OutputOptions &output,
+                     const OutputRegion &region, size_t fieldEvery);
+    //Finishes the checkpoint in progress
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    //Saves the state of the engine after the given step, with the size and number of snapshots of the
+    //output so far (from SnapshotWriter::flush)
+    void save(SteppingEngine &engine, uint64_t step, uint64_t outputSize, uint64_t nsnapshots);
+
+  private:
+    void run();
+    void write();
+
+    std::string filename;
+    BinaryHeader header;
+    CheckpointRecord record;
+    Field rho;
+    Field rho_prev;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool pending = false;
+    bool stopping = false;
+    std::thread thread;
+};
+
+#endif
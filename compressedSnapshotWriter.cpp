@@ -0,0 +1,76 @@
+//compressedSnapshotWriter.cpp
+//
+//Binary snapshot output with block-wise parallel compression
+#include <algorithm>
+#include <omp.h>
+#include "compressedSnapshotWriter.h"
+#include "phaseProfiler.h"
+
+CompressedSnapshotWriter::CompressedSnapshotWriter(const std::string &filename, std::unique_ptr<SnapshotCodec> codec,
+                                                   double tolerance, size_t blockPoints, int nthreads, bool resume)
+  : fout(filename, outputMode(resume)), codec(std::move(codec)), tolerance(tolerance),
+    blockPoints(std::max<size_t>(blockPoints, 1)), nthreads(nthreads)
+{
+    if (this->nthreads <= 0) {
+        this->nthreads = omp_get_max_threads();
+    }
+}
+
+void CompressedSnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    header = makeBinaryHeader(param, 0);
+    header.codec = codec->id();
+    header.blockPoints = static_cast<uint32_t>(blockPoints);
+    header.tolerance = (codec->id() == codecLossy) ? tolerance : 0.0;
+    BinaryHeader little = headerToLittleEndian(header);
+    fout.write(reinterpret_cast<const char*>(&little), sizeof(little));
+    writeGridLittleEndian(fout, x);
+    // One reusable output buffer per block, reserved for the worst case
+    blocks.resize((param.ngrid + blockPoints - 1)/blockPoints);
+    for (std::vector<unsigned char> &block : blocks) {
+        block.reserve(codec->maxEncodedSize(blockPoints));
+    }
+}
+
+void CompressedSnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    const long nblocks = static_cast<long>(blocks.size());
+    {
+        PROFILE_SCOPE(format);
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for (long b = 0; b < nblocks; b++) {
+            size_t begin = static_cast<size_t>(b)*blockPoints;
+            size_t n = std::min(blockPoints, header.ngrid - begin);
+            codec->encode(rho.data() + begin, n, blocks[static_cast<size_t>(b)]);
+        }
+    }
+    PROFILE_SCOPE(write);
+
+    BinarySnapshotHeader record;
+    record.index = toLittleEndian<uint64_t>(header.nsnapshots);
+    record.step  = toLittleEndian<uint64_t>(step);
+    record.time  = toLittleEndian(static_cast<double>(step)*header.dt);
+    fout.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    for (const std::vector<unsigned char> &block : blocks) {
+        uint64_t size = toLittleEndian<uint64_t>(block.size());
+        fout.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        fout.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+    }
+    header.nsnapshots++;
+}
+
+void CompressedSnapshotWriter::close(){
+    // Record the number of snapshots now that it is known
+    BinaryHeader little = headerToLittleEndian(header);
+    fout.seekp(0);
+    fout.write(reinterpret_cast<const char*>(&little), sizeof(little));
+    fout.close();
+}
+
+uint64_t CompressedSnapshotWriter::flush(){
+    fout.flush();
+    return static_cast<uint64_t>(fout.tellp());
+}
+
+void CompressedSnapshotWriter::resume(uint64_t size, uint64_t nsnapshots){
+    header.nsnapshots = nsnapshots;
+    fout.seekp(static_cast<std::streamoff>(size));
+}
@@ -0,0 +1,37 @@
+#ifndef COMPRESSEDSNAPSHOTWRITER_H
+#define COMPRESSEDSNAPSHOTWRITER_H
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "snapshotWriter.h"
+#include "snapshotCodecs.h"
+
+//Writes the binary format with compressed snapshot values (see BinaryHeader). Each snapshot is cut into
+//blocks that are encoded in parallel by nthreads OpenMP threads (0 uses the OpenMP default); the
+//per-block buffers are kept between snapshots. Combine with AsyncSnapshotWriter to take the
+//compression off the stepping thread.
+class CompressedSnapshotWriter : public SnapshotWriter {
+  public:
+    CompressedSnapshotWriter(const std::string &filename, std::unique_ptr<SnapshotCodec> codec,
+                             double tolerance, size_t blockPoints, int nthreads, bool resume = false);
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+    void writeSnapshot(size_t step, const Field &rho) override;
+    void close() override;
+    uint64_t flush() override;
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+  private:
+    std::ofstream fout;
+    std::unique_ptr<SnapshotCodec> codec;
+    double tolerance;
+    size_t blockPoints;
+    int nthreads;
+    BinaryHeader header;
+    std::vector<std::vector<unsigned char>> blocks;
+};
+
+#endif
@@ -0,0 +1,51 @@
+//ensembleKernel.cpp
+//
+//Lockstep stepping of an ensemble of simulations in an interleaved layout
+#include "ensembleKernel.h"
+#include "stencilKernel.h"
+
+EnsembleKernel::EnsembleKernel(const std::vector<Parameters> &params)
+  : members(params.size()), ngrid(params.empty() ? 0 : params[0].ngrid)
+{
+    for (const Parameters &param : params) {
+        StencilKernel member(param);
+        a.push_back(member.a);
+        b.push_back(member.b);
+        k.push_back(member.k);
+    }
+}
+
+//Compiled for several instruction sets, the best one is picked when the program is loaded
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+__attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+void ensembleStep(const EnsembleKernel &kernel, const double *__restrict rho, const double *__restrict rho_prev,
+                  double *__restrict rho_next){
+    const size_t M = kernel.members;
+    const double *__restrict a = kernel.a.data();
+    const double *__restrict b = kernel.b.data();
+    const double *__restrict k = kernel.k.data();
+    for (size_t i = 1; i + 1 < kernel.ngrid; i++) {
+        const double *here = rho + i*M;
+        const double *left = here - M;
+        const double *right = here + M;
+        const double *previous = rho_prev + i*M;
+        double *next = rho_next + i*M;
+        #pragma omp simd
+        for (size_t m = 0; m < M; m++) {
+            next[m] = a[m]*here[m] + b[m]*previous[m] + k[m]*(left[m] + right[m]);
+        }
+    }
+}
+
+void extractMember(const EnsembleKernel &kernel, const Field &ensemble, size_t m, Field &member){
+    for (size_t i = 0; i < kernel.ngrid; i++) {
+        member[i] = ensemble[i*kernel.members + m];
+    }
+}
+
+void insertMember(const EnsembleKernel &kernel, const Field &member, size_t m, Field &ensemble){
+    for (size_t i = 0; i < kernel.ngrid; i++) {
+        ensemble[i*kernel.members + m] = member[i];
+    }
+}
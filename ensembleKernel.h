@@ -0,0 +1,31 @@
+#ifndef ENSEMBLEKERNEL_H
+#define ENSEMBLEKERNEL_H
+
+#include <cstddef>
+#include <vector>
+#include "wave1d.h"
+
+//Stencil coefficients of M independent simulations on grids of the same size, advanced in lockstep.
+//The fields are stored interleaved, value m of grid point i at index i*M + m, so that consecutive
+//SIMD lanes hold consecutive members and each member keeps its own a, b and k.
+class EnsembleKernel {
+  public:
+    std::vector<double> a;  // per member, as in StencilKernel
+    std::vector<double> b;
+    std::vector<double> k;
+    size_t members;         // M
+    size_t ngrid;           // number of x points, the same for all members
+
+    //All members must share ngrid; stepping them together also requires the same nsteps and nper
+    explicit EnsembleKernel(const std::vector<Parameters> &params);
+};
+
+//Evolves the interior of all members over one time step; the Dirichlet rows i=0 and i=ngrid-1 are not
+//touched. Every member gets exactly the arithmetic of stencilScalar, so results match standalone runs.
+void ensembleStep(const EnsembleKernel &kernel, const double *rho, const double *rho_prev, double *rho_next);
+
+//Copies member m of an interleaved field into a plain field of ngrid values, or back
+void extractMember(const EnsembleKernel &kernel, const Field &ensemble, size_t m, Field &member);
+void insertMember(const EnsembleKernel &kernel, const Field &member, size_t m, Field &ensemble);
+
+#endif
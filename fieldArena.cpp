@@ -0,0 +1,53 @@
+//fieldArena.cpp
+//
+//Huge page backed, NUMA placed memory for the time levels
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include "fieldArena.h"
+#include "threadedStepping.h"
+
+// size of a transparent huge page on x86-64 and (with 4 kB base pages) aarch64
+static const size_t hugePageBytes = size_t(2) << 20;
+
+FieldArena::FieldArena(size_t ngrid, size_t nlevels, int nthreads)
+  : ngrid(ngrid), stride((ngrid + 7)/8*8)
+{
+    // Map a huge page more than needed, so that the block can start on a huge page boundary
+    const size_t bytes = std::max<size_t>(nlevels*stride*sizeof(double), 1);
+    const size_t blockBytes = (bytes + hugePageBytes - 1)/hugePageBytes*hugePageBytes;
+    mappingBytes = blockBytes + hugePageBytes;
+    void* address = ::mmap(nullptr, mappingBytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    mapping = static_cast<char*>(address);
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(mapping);
+    std::uintptr_t aligned = (start + hugePageBytes - 1)/hugePageBytes*hugePageBytes;
+    block = reinterpret_cast<double*>(aligned);
+#ifdef MADV_HUGEPAGE
+    huge = ::madvise(block, blockBytes, MADV_HUGEPAGE) == 0;
+#endif
+
+    // Nothing is placed until written: touch every level with the partition evolveThreaded steps with,
+    // the last chunk also taking the padding
+    double* levels = block;
+    const size_t padded = stride;
+    forEachThreadChunk(ngrid, nthreads, [levels, nlevels, padded, ngrid](size_t begin, size_t end) {
+        if (end == ngrid) {
+            end = padded;
+        }
+        for (size_t n = 0; n < nlevels; n++) {
+            std::fill(levels + n*padded + begin, levels + n*padded + end, 0.0);
+        }
+    });
+}
+
+FieldArena::~FieldArena(){
+    ::munmap(mapping, mappingBytes);
+}
+
+FieldSpan FieldArena::level(size_t n) const{
+    return {block + n*stride, ngrid};
+}
@@ -0,0 +1,47 @@
+#ifndef FIELDARENA_H
+#define FIELDARENA_H
+
+#include <cstddef>
+
+//A time level of ngrid values in memory owned by someone else, e.g. a FieldArena. Swapping two spans
+//exchanges only the pointers, like swapping two Fields.
+struct FieldSpan {
+    double* values = nullptr;
+    size_t  count = 0;
+
+    double* data() const { return values; }
+    size_t size() const { return count; }
+    double* begin() const { return values; }
+    double* end() const { return values + count; }
+    double &operator[](size_t i) const { return values[i]; }
+};
+
+//One anonymous mapping that holds all time levels of a run, each starting on a 64 byte boundary.
+//The block is aligned to and asks the kernel for transparent huge pages, so the stencil streams need
+//few TLB entries, and it is touched first by the same static chunk partition as evolveThreaded on
+//nthreads threads (0 for the OpenMP default), so each page is placed on the NUMA node of the thread
+//that steps it. With OMP_PROC_BIND=close or spread the threads then stay next to their pages.
+class FieldArena {
+  public:
+    //Maps nlevels levels of ngrid values, all zero; throws std::bad_alloc if the mapping fails
+    FieldArena(size_t ngrid, size_t nlevels, int nthreads);
+    ~FieldArena();
+    FieldArena(const FieldArena &) = delete;
+    FieldArena &operator=(const FieldArena &) = delete;
+
+    //Gives time level n, 0 <= n < nlevels
+    FieldSpan level(size_t n) const;
+
+    //Whether the kernel accepted the request for huge pages (it may still back parts with small pages)
+    bool hugePages() const { return huge; }
+
+  private:
+    char*  mapping = nullptr;   // start of the mapping, which begins before the aligned block
+    size_t mappingBytes = 0;
+    double* block = nullptr;    // first value of level 0
+    size_t ngrid;
+    size_t stride;              // values from the start of one level to the next
+    bool   huge = false;
+};
+
+#endif
@@ -0,0 +1,322 @@
+//gpuStepping.cu
+//
+//GPU backend: device-resident time stepping with CUDA, or with HIP when compiled by hipcc. Experimental, it
+//is only built with EXPERIMENTAL_GPU=1; a failing runtime call ends the run with an error, not the program.
+//Compile without contraction into fused multiply-adds (--fmad=false, -ffp-contract=off) so that
+//results agree bit for bit with the CPU stencils.
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "gpuStepping.h"
+
+#if defined(__HIPCC__)
+#include <hip/hip_runtime.h>
+#define gpuError_t               hipError_t
+#define gpuSuccess               hipSuccess
+#define gpuGetErrorString        hipGetErrorString
+#define gpuGetDeviceCount        hipGetDeviceCount
+#define gpuGetLastError          hipGetLastError
+#define gpuMalloc                hipMalloc
+#define gpuFree                  hipFree
+#define gpuHostAlloc             hipHostMalloc
+#define gpuHostAllocDefault      hipHostMallocDefault
+#define gpuFreeHost              hipHostFree
+#define gpuMemcpy                hipMemcpy
+#define gpuMemcpyAsync           hipMemcpyAsync
+#define gpuMemcpyHostToDevice    hipMemcpyHostToDevice
+#define gpuMemcpyDeviceToHost    hipMemcpyDeviceToHost
+#define gpuMemcpyDeviceToDevice  hipMemcpyDeviceToDevice
+#define gpuStream_t              hipStream_t
+#define gpuStreamCreate          hipStreamCreate
+#define gpuStreamDestroy         hipStreamDestroy
+#define gpuStreamSynchronize     hipStreamSynchronize
+#define gpuStreamWaitEvent       hipStreamWaitEvent
+#define gpuEvent_t               hipEvent_t
+#define gpuEventCreateWithFlags  hipEventCreateWithFlags
+#define gpuEventDisableTiming    hipEventDisableTiming
+#define gpuEventDestroy          hipEventDestroy
+#define gpuEventRecord           hipEventRecord
+#define gpuEventSynchronize      hipEventSynchronize
+#else
+#include <cuda_runtime.h>
+#define gpuError_t               cudaError_t
+#define gpuSuccess               cudaSuccess
+#define gpuGetErrorString        cudaGetErrorString
+#define gpuGetDeviceCount        cudaGetDeviceCount
+#define gpuGetLastError          cudaGetLastError
+#define gpuMalloc                cudaMalloc
+#define gpuFree                  cudaFree
+#define gpuHostAlloc             cudaHostAlloc
+#define gpuHostAllocDefault      cudaHostAllocDefault
+#define gpuFreeHost              cudaFreeHost
+#define gpuMemcpy                cudaMemcpy
+#define gpuMemcpyAsync           cudaMemcpyAsync
+#define gpuMemcpyHostToDevice    cudaMemcpyHostToDevice
+#define gpuMemcpyDeviceToHost    cudaMemcpyDeviceToHost
+#define gpuMemcpyDeviceToDevice  cudaMemcpyDeviceToDevice
+#define gpuStream_t              cudaStream_t
+#define gpuStreamCreate          cudaStreamCreate
+#define gpuStreamDestroy         cudaStreamDestroy
+#define gpuStreamSynchronize     cudaStreamSynchronize
+#define gpuStreamWaitEvent       cudaStreamWaitEvent
+#define gpuEvent_t               cudaEvent_t
+#define gpuEventCreateWithFlags  cudaEventCreateWithFlags
+#define gpuEventDisableTiming    cudaEventDisableTiming
+#define gpuEventDestroy          cudaEventDestroy
+#define gpuEventRecord           cudaEventRecord
+#define gpuEventSynchronize      cudaEventSynchronize
+#endif
+
+//A failed runtime call, passed up to evolveGpu and given back as its error
+struct GpuFailure {
+    std::string message;
+};
+
+//Throws a GpuFailure when a runtime call fails
+static void check(gpuError_t error, const char* what){
+    if (error != gpuSuccess) {
+        throw GpuFailure{std::string("GPU call ") + what + " failed: " + gpuGetErrorString(error)};
+    }
+}
+
+//Device memory, streams and events of one run, released however the run ends
+struct GpuResources {
+    double* d_rho = nullptr;
+    double* d_prev = nullptr;
+    double* d_next = nullptr;
+    double* d_extra = nullptr;
+    double* d_snap[2] = {nullptr, nullptr};
+    double* pinned[2] = {nullptr, nullptr};
+    gpuStream_t compute{};
+    gpuStream_t copy{};
+    bool streams[2] = {false, false};
+    gpuEvent_t staged[2]{};
+    gpuEvent_t copied[2]{};
+    bool stagedMade[2] = {false, false};
+    bool copiedMade[2] = {false, false};
+
+    GpuResources() = default;
+    GpuResources(const GpuResources &) = delete;
+    GpuResources &operator=(const GpuResources &) = delete;
+    ~GpuResources(){
+        // Errors are ignored here, the first failure has already been reported
+        if (streams[0]) {
+            gpuStreamSynchronize(compute);
+        }
+        if (streams[1]) {
+            gpuStreamSynchronize(copy);
+        }
+        for (int j = 0; j < 2; j++) {
+            if (stagedMade[j]) {
+                gpuEventDestroy(staged[j]);
+            }
+            if (copiedMade[j]) {
+                gpuEventDestroy(copied[j]);
+            }
+            gpuFree(d_snap[j]);
+            gpuFreeHost(pinned[j]);
+        }
+        if (streams[0]) {
+            gpuStreamDestroy(compute);
+        }
+        if (streams[1]) {
+            gpuStreamDestroy(copy);
+        }
+        gpuFree(d_rho);
+        gpuFree(d_prev);
+        gpuFree(d_next);
+        gpuFree(d_extra);
+    }
+};
+
+// threads per block; for the blocked kernel also the number of points a block owns
+const int threadsPerBlock = 256;
+
+struct Coefficients {
+    double a;
+    double b;
+    double k;
+};
+
+//One step for the whole grid, with the zero Dirichlet boundary written in the same launch
+__global__ void stepKernel(Coefficients c, size_t ngrid, const double* __restrict__ rho,
+                           const double* __restrict__ prev, double* __restrict__ next){
+    size_t i = blockIdx.x*static_cast<size_t>(blockDim.x) + threadIdx.x;
+    if (i >= ngrid) {
+        return;
+    }
+    if (i == 0 or i == ngrid-1) {
+        next[i] = 0.0;
+    } else {
+        next[i] = c.a*rho[i] + c.b*prev[i] + c.k*(rho[i-1] + rho[i+1]);
+    }
+}
+
+//k steps at once: each block loads the points it owns plus k on either side into shared memory,
+//advances them k steps (the valid region shrinking by one point per side and step) and stores the
+//final two levels of its own points in outRho and outPrev
+__global__ void blockedKernel(Coefficients c, size_t ngrid, int k, const double* __restrict__ rho,
+                              const double* __restrict__ prev, double* __restrict__ outRho,
+                              double* __restrict__ outPrev){
+    extern __shared__ double shared[];
+    const int tile = blockDim.x;
+    const int width = tile + 2*k;
+    double* current = shared;
+    double* previous = shared + width;
+    double* next = shared + 2*width;
+    const long long lo = static_cast<long long>(blockIdx.x)*tile;
+    const long long wlo = lo - k;
+    const long long last = static_cast<long long>(ngrid) - 1;
+
+    for (int j = threadIdx.x; j < width; j += blockDim.x) {
+        long long g = wlo + j;
+        bool inside = (g >= 0 and g <= last);
+        current[j] = inside ? rho[g] : 0.0;
+        previous[j] = inside ? prev[g] : 0.0;
+    }
+    __syncthreads();
+
+    for (int step = 1; step <= k; step++) {
+        for (int j = threadIdx.x; j < width; j += blockDim.x) {
+            long long g = wlo + j;
+            double value = 0.0;  // boundary, outside the grid, or no longer valid (never read)
+            if (g > 0 and g < last and j >= step and j < width - step) {
+                value = c.a*current[j] + c.b*previous[j] + c.k*(current[j-1] + current[j+1]);
+            }
+            next[j] = value;
+        }
+        // The buffer written next step was last read in this step
+        __syncthreads();
+        double* oldest = previous;
+        previous = current;
+        current = next;
+        next = oldest;
+    }
+
+    for (int j = k + threadIdx.x; j < k + tile; j += blockDim.x) {
+        long long g = wlo + j;
+        if (g <= last) {
+            outRho[g] = current[j];
+            outPrev[g] = previous[j];
+        }
+    }
+}
+
+bool gpuAvailable(){
+    int count = 0;
+    return gpuGetDeviceCount(&count) == gpuSuccess and count > 0;
+}
+
+//The run of evolveGpu, throwing a GpuFailure when a runtime call fails
+static void evolveDevice(GpuResources &r, Field &rho, Field &rho_prev, const StencilKernel &kernel, size_t nsteps,
+                         size_t nper, size_t stepsPerLaunch, const std::function<void(size_t)> &snapshot,
+                         std::atomic<size_t> *progress){
+    const size_t ngrid = kernel.ngrid;
+    const size_t bytes = ngrid*sizeof(double);
+    const Coefficients c = {kernel.a, kernel.b, kernel.k};
+    const unsigned blocks = static_cast<unsigned>((ngrid + threadsPerBlock - 1)/threadsPerBlock);
+    stepsPerLaunch = std::max<size_t>(stepsPerLaunch, 1);
+
+    // Zero Dirichlet boundary conditions on the initial levels
+    rho[0] = rho[ngrid-1] = 0.0;
+    rho_prev[0] = rho_prev[ngrid-1] = 0.0;
+
+    // Device-resident time levels, plus a fourth for the blocked kernel and two snapshot staging buffers
+    // that hold both rho and rho_prev
+    check(gpuMalloc(&r.d_rho, bytes), "malloc");
+    check(gpuMalloc(&r.d_prev, bytes), "malloc");
+    check(gpuMalloc(&r.d_next, bytes), "malloc");
+    check(gpuMalloc(&r.d_extra, bytes), "malloc");
+    check(gpuStreamCreate(&r.compute), "stream create");
+    r.streams[0] = true;
+    check(gpuStreamCreate(&r.copy), "stream create");
+    r.streams[1] = true;
+    for (int j = 0; j < 2; j++) {
+        check(gpuMalloc(&r.d_snap[j], 2*bytes), "malloc");
+        check(gpuHostAlloc(reinterpret_cast<void**>(&r.pinned[j]), 2*bytes, gpuHostAllocDefault), "host alloc");
+        check(gpuEventCreateWithFlags(&r.staged[j], gpuEventDisableTiming), "event create");
+        r.stagedMade[j] = true;
+        check(gpuEventCreateWithFlags(&r.copied[j], gpuEventDisableTiming), "event create");
+        r.copiedMade[j] = true;
+        check(gpuEventRecord(r.copied[j], r.copy), "event record");
+    }
+    check(gpuMemcpy(r.d_rho, rho.data(), bytes, gpuMemcpyHostToDevice), "memcpy");
+    check(gpuMemcpy(r.d_prev, rho_prev.data(), bytes, gpuMemcpyHostToDevice), "memcpy");
+
+    // A snapshot whose copy to the host has been started but not yet handed to the caller
+    bool pending = false;
+    size_t pendingStep = 0;
+    int pendingSlot = 0;
+    auto deliver = [&]() {
+        check(gpuEventSynchronize(r.copied[pendingSlot]), "event synchronize");
+        std::memcpy(rho.data(), r.pinned[pendingSlot], bytes);
+        std::memcpy(rho_prev.data(), r.pinned[pendingSlot] + ngrid, bytes);
+        snapshot(pendingStep);
+        pending = false;
+    };
+
+    int slot = 0;
+    size_t s = 0;
+    while (s < nsteps) {
+        // Never step past the next snapshot or the end of the run
+        size_t k = std::min({stepsPerLaunch, nper - s%nper, nsteps - s});
+        if (k == 1) {
+            stepKernel<<<blocks, threadsPerBlock, 0, r.compute>>>(c, ngrid, r.d_rho, r.d_prev, r.d_next);
+            // Rotate such that t+1 becomes the new t etc.
+            std::swap(r.d_prev, r.d_rho);
+            std::swap(r.d_rho, r.d_next);
+        } else {
+            size_t shared = 3*(threadsPerBlock + 2*k)*sizeof(double);
+            blockedKernel<<<blocks, threadsPerBlock, shared, r.compute>>>(c, ngrid, static_cast<int>(k),
+                                                                        r.d_rho, r.d_prev, r.d_next, r.d_extra);
+            std::swap(r.d_rho, r.d_next);
+            std::swap(r.d_prev, r.d_extra);
+        }
+        check(gpuGetLastError(), "kernel launch");
+        s += k;
+        if (progress) {
+            progress->fetch_add(k, std::memory_order_relaxed);
+        }
+
+        if (s%nper == 0) {
+            // Stage on the device, then copy to pinned memory while the next steps run
+            check(gpuStreamWaitEvent(r.compute, r.copied[slot], 0), "stream wait");
+            check(gpuMemcpyAsync(r.d_snap[slot], r.d_rho, bytes, gpuMemcpyDeviceToDevice, r.compute), "memcpy");
+            check(gpuMemcpyAsync(r.d_snap[slot] + ngrid, r.d_prev, bytes, gpuMemcpyDeviceToDevice, r.compute),
+                  "memcpy");
+            check(gpuEventRecord(r.staged[slot], r.compute), "event record");
+            check(gpuStreamWaitEvent(r.copy, r.staged[slot], 0), "stream wait");
+            check(gpuMemcpyAsync(r.pinned[slot], r.d_snap[slot], 2*bytes, gpuMemcpyDeviceToHost, r.copy), "memcpy");
+            check(gpuEventRecord(r.copied[slot], r.copy), "event record");
+            if (pending) {
+                deliver();
+            }
+            pending = true;
+            pendingStep = s;
+            pendingSlot = slot;
+            slot = 1 - slot;
+        }
+    }
+    if (pending) {
+        deliver();
+    }
+
+    // Leave the final state on the host
+    check(gpuStreamSynchronize(r.compute), "stream synchronize");
+    check(gpuMemcpy(rho.data(), r.d_rho, bytes, gpuMemcpyDeviceToHost), "memcpy");
+    check(gpuMemcpy(rho_prev.data(), r.d_prev, bytes, gpuMemcpyDeviceToHost), "memcpy");
+}
+
+bool evolveGpu(Field &rho, Field &rho_prev, const StencilKernel &kernel, size_t nsteps, size_t nper,
+               size_t stepsPerLaunch, const std::function<void(size_t)> &snapshot, std::string &error,
+               std::atomic<size_t> *progress){
+    GpuResources resources;
+    try {
+        evolveDevice(resources, rho, rho_prev, kernel, nsteps, nper, stepsPerLaunch, snapshot, progress);
+    } catch (const GpuFailure &failure) {
+        error = failure.message;
+        return false;
+    }
+    return true;
+}
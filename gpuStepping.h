@@ -0,0 +1,32 @@
+#ifndef GPUSTEPPING_H
+#define GPUSTEPPING_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "wave1d.h"
+#include "stencilKernel.h"
+
+//Default number of steps advanced per kernel launch with shared-memory temporal blocking
+const size_t defaultGpuStepsPerLaunch = 16;
+
+//Whether this build contains the GPU backend (wave1d_gpu or wave1d_hip) and a device is present. The
+//backend is experimental: it is not built or checked against the CPU stencils by the default targets,
+//and its targets only build with EXPERIMENTAL_GPU=1 (see the Makefile).
+bool gpuAvailable();
+
+//Evolves the wave over nsteps time steps on the GPU. rho, rho_prev and the next level stay in device
+//memory for the whole run; every launch advances the grid by up to stepsPerLaunch steps (1 gives one
+//fused stencil-plus-boundary launch per step, more use overlapped tiles in shared memory).
+//At every step s with (s+1)%nper == 0 the wave is copied asynchronously into a pinned host buffer while
+//the device keeps stepping, then placed in rho (and the level before in rho_prev) before snapshot(s+1)
+//is called. On return rho and rho_prev hold the final state. A given progress counter is advanced as the
+//launches are queued. Results are identical to repeated calls of timeStep.
+//Gives false and the reason in error if a runtime call fails (or the build has no GPU backend); the
+//device memory is released and rho and rho_prev hold the last snapshot handed to the callback.
+bool evolveGpu(Field &rho, Field &rho_prev, const StencilKernel &kernel, size_t nsteps, size_t nper,
+               size_t stepsPerLaunch, const std::function<void(size_t)> &snapshot, std::string &error,
+               std::atomic<size_t> *progress = nullptr);
+
+#endif
@@ -0,0 +1,14 @@
+//gpuStub.cpp
+//
+//Stands in for gpuStepping.cu in builds without CUDA or HIP
+#include "gpuStepping.h"
+
+bool gpuAvailable(){
+    return false;
+}
+
+bool evolveGpu(Field &, Field &, const StencilKernel &, size_t, size_t, size_t, const std::function<void(size_t)> &,
+               std::string &error, std::atomic<size_t> *){
+    error = "this wave1d was built without the experimental GPU backend, see 'make wave1d_gpu EXPERIMENTAL_GPU=1'";
+    return false;
+}
@@ -0,0 +1,145 @@
+//inSituAnalysis.cpp
+//
+//Reductions of the wave computed during the run, written as a compact time series
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include "inSituAnalysis.h"
+
+bool parseReductions(const std::string &list, std::vector<Reduction> &reductions){
+    std::istringstream names(list);
+    std::string name;
+    reductions.clear();
+    while (std::getline(names, name, ',')) {
+        if (name == "energy") {
+            reductions.push_back(Reduction::energy);
+        } else if (name == "l2") {
+            reductions.push_back(Reduction::l2);
+        } else if (name == "max") {
+            reductions.push_back(Reduction::max);
+        } else if (name == "mean") {
+            reductions.push_back(Reduction::mean);
+        } else {
+            return false;
+        }
+    }
+    return not reductions.empty();
+}
+
+//Length in bytes of the lines of an existing series up to and including the line of resumeStep
+static std::uintmax_t seriesLength(const std::string &filename, size_t resumeStep){
+    std::ifstream fin(filename);
+    std::string line;
+    std::uintmax_t length = 0;
+    while (std::getline(fin, line)) {
+        if (not line.empty() and line[0] != '#' and std::strtoull(line.c_str(), nullptr, 10) > resumeStep) {
+            break;
+        }
+        length += line.size() + 1;
+    }
+    return length;
+}
+
+InSituAnalysis::InSituAnalysis(const std::string &filename, const std::vector<Reduction> &reductions,
+                               const Parameters &param, const UniformGrid &x, size_t resumeStep)
+  : reductions(reductions), x(x), c(param.c), dx(param.dx), dt(param.dt)
+{
+    if (resumeStep > 0 and std::filesystem::exists(filename)) {
+        std::filesystem::resize_file(filename, seriesLength(filename, resumeStep));
+        fout.open(filename, std::ios::app);
+    } else {
+        fout.open(filename);
+        fout << "# step time";
+        for (Reduction reduction : reductions) {
+            switch (reduction) {
+                case Reduction::energy: fout << " energy"; break;
+                case Reduction::l2:     fout << " l2"; break;
+                case Reduction::max:    fout << " max xmax"; break;
+                case Reduction::mean:   fout << " mean"; break;
+            }
+        }
+        fout << "\n";
+    }
+    if (not fout) {
+        std::cerr << "Error: cannot write the series '" << filename << "'.\n";
+        std::exit(1);
+    }
+    // Enough digits to read every value back exactly
+    fout.precision(std::numeric_limits<double>::max_digits10);
+}
+
+void InSituAnalysis::sample(size_t step, const Field &rho, const Field &rho_prev){
+    const long ngrid = static_cast<long>(rho.size());
+    const double* now = rho.data();
+    const double* before = rho_prev.data();
+    const double rdt = 1.0/dt;
+    const double rdx = 1.0/dx;
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double squares = 0.0;
+    double sum = 0.0;
+    double maxvalue = -1.0;
+    long maxindex = 0;
+
+    // One pass over the grid, and only for the quantities the chosen reductions need
+    const bool energy = wants(Reduction::energy);
+    const bool l2 = wants(Reduction::l2);
+    const bool mean = wants(Reduction::mean);
+    const bool max = wants(Reduction::max);
+    #pragma omp parallel
+    {
+        double localMax = -1.0;
+        long localIndex = 0;
+        #pragma omp for schedule(static) reduction(+:kinetic,potential,squares,sum) nowait
+        for (long i = 0; i < ngrid; i++) {
+            if (energy) {
+                double velocity = (now[i] - before[i])*rdt;
+                double gradient = (i + 1 < ngrid) ? (now[i+1] - now[i])*rdx : 0.0;
+                kinetic += velocity*velocity;
+                potential += gradient*gradient;
+            }
+            if (l2) {
+                squares += now[i]*now[i];
+            }
+            if (mean) {
+                sum += now[i];
+            }
+            if (max and std::fabs(now[i]) > localMax) {
+                localMax = std::fabs(now[i]);
+                localIndex = i;
+            }
+        }
+        // Each thread has one contiguous range of points, so the first occurrence of the largest value
+        // wins, whatever the number of threads
+        if (max) {
+            #pragma omp critical
+            if (localMax > maxvalue or (localMax == maxvalue and localIndex < maxindex)) {
+                maxvalue = localMax;
+                maxindex = localIndex;
+            }
+        }
+    }
+
+    fout << step << " " << static_cast<double>(step)*dt;
+    for (Reduction reduction : reductions) {
+        switch (reduction) {
+            case Reduction::energy: fout << " " << 0.5*(kinetic + c*c*potential)*dx; break;
+            case Reduction::l2:     fout << " " << std::sqrt(squares*dx); break;
+            case Reduction::max:    fout << " " << maxvalue << " " << x[static_cast<size_t>(maxindex)]; break;
+            case Reduction::mean:   fout << " " << sum/static_cast<double>(ngrid); break;
+        }
+    }
+    fout << "\n";
+}
+
+bool InSituAnalysis::wants(Reduction reduction) const{
+    return std::find(reductions.begin(), reductions.end(), reduction) != reductions.end();
+}
+
+void InSituAnalysis::close(){
+    fout.close();
+}
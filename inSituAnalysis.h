@@ -0,0 +1,49 @@
+#ifndef INSITUANALYSIS_H
+#define INSITUANALYSIS_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+
+//Quantities the in-situ analysis can reduce the wave to
+enum class Reduction {
+    energy,     // sum over the grid of (drho/dt)^2/2 + c^2 (drho/dx)^2/2, times dx
+    l2,         // sqrt of the sum of rho^2 dx
+    max,        // largest |rho| and the x where it occurs (two columns)
+    mean        // average of rho over the grid
+};
+
+//Converts a comma separated list such as "energy,max,l2" to reductions, false for an unknown name
+bool parseReductions(const std::string &list, std::vector<Reduction> &reductions);
+
+//Reduces each sampled wave to a few numbers and writes them as one line of a text time series:
+//"step time" followed by the columns of the chosen reductions, with a comment line naming them.
+//The chosen reductions come out of a single OpenMP parallel pass over rho and rho_prev, which computes
+//only the sums they need.
+class InSituAnalysis {
+  public:
+    //Starts a new series; a restarted run (resumeStep > 0) instead keeps the lines of the series up to
+    //and including resumeStep and continues after them
+    InSituAnalysis(const std::string &filename, const std::vector<Reduction> &reductions,
+                   const Parameters &param, const UniformGrid &x, size_t resumeStep = 0);
+
+    //Adds the line for the wave rho at the given step, with rho_prev the wave one step earlier
+    void sample(size_t step, const Field &rho, const Field &rho_prev);
+
+    void close();
+
+  private:
+    //Whether the reduction is among the chosen ones
+    bool wants(Reduction reduction) const;
+
+    std::ofstream fout;
+    std::vector<Reduction> reductions;
+    UniformGrid x;
+    double c;
+    double dx;
+    double dt;
+};
+
+#endif
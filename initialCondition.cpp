@@ -0,0 +1,188 @@
+//initialCondition.cpp
+//
+//The built-in shapes of the initial wave
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "initialCondition.h"
+#include "snapshotWriter.h"
+#include "threadedStepping.h"
+#include "simdKernels.h"
+
+bool parseInitialCondition(const std::string &text, InitialCondition &initial){
+    if (text == "triangle") {
+        initial.profile = Profile::triangle;
+    } else if (text == "gaussian") {
+        initial.profile = Profile::gaussian;
+    } else if (text.rfind("gaussian:", 0) == 0) {
+        initial.profile = Profile::gaussian;
+        char* end = nullptr;
+        initial.sigma = std::strtod(text.c_str() + 9, &end);
+        if (*end != '\0' or not (initial.sigma > 0.0)) {
+            return false;
+        }
+    } else if (text.rfind("file:", 0) == 0 and text.size() > 5) {
+        initial.profile = Profile::file;
+        initial.filename = text.substr(5);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//Smallest argument of negativeExp, below which exp underflows to 0
+static const double expLowest = -745.5;
+
+//2^k for a whole number -1022 <= k <= 1023, by placing k+1023 in the exponent field: adding 1.5*2^52
+//leaves it in the low bits of the mantissa
+static inline double exponentScale(double k){
+    double shifted = k + 1023.0 + 6755399441055744.0;
+    uint64_t bits;
+    std::memcpy(&bits, &shifted, sizeof(bits));
+    bits <<= 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return scale;
+}
+
+//exp(x) for expLowest <= x <= 0 in plain arithmetic, which vectorizes unlike the library call std::exp.
+//x = n*ln2 + r with |r| <= ln2/2 (ln2 in two parts, so that n times the first is exact), exp(r) by its
+//Taylor series to degree 13, and 2^n as two factors, so that results below the normal range are rounded
+//once by the last multiplication. Within 1 ulp of std::exp.
+static inline double negativeExp(double x){
+    const double n = (x*1.4426950408889634 + 6755399441055744.0) - 6755399441055744.0;  // nearest whole number
+    const double r = (x - n*6.93147180369123816490e-01) - n*1.90821492927058770002e-10;
+    double p = 1.0/6227020800.0;
+    p = p*r + 1.0/479001600.0;
+    p = p*r + 1.0/39916800.0;
+    p = p*r + 1.0/3628800.0;
+    p = p*r + 1.0/362880.0;
+    p = p*r + 1.0/40320.0;
+    p = p*r + 1.0/5040.0;
+    p = p*r + 1.0/720.0;
+    p = p*r + 1.0/120.0;
+    p = p*r + 1.0/24.0;
+    p = p*r + 1.0/6.0;
+    p = p*r + 0.5;
+    p = p*r + 1.0;
+    p = p*r + 1.0;
+    const double half = (0.5*n + 6755399441055744.0) - 6755399441055744.0;
+    return p*exponentScale(half)*exponentScale(n - half);
+}
+
+//A gaussian pulse of the same height as the triangle at the points begin..end-1
+WAVE1D_TARGET_CLONES
+static void gaussianRange(const UniformGrid &x, double xmid, double scale, double *rho, size_t begin, size_t end){
+    double xs[512];
+    for (size_t block = begin; block < end; block += 512) {
+        const size_t n = std::min<size_t>(512, end - block);
+        x.values(block, block + n, xs);
+        double* values = rho + block;
+        // The arguments are clamped in a loop of their own: folded into the next one, the compiler
+        // splits off the clamped case into a branch and the loop no longer vectorizes
+        #pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            double distance = xs[i] - xmid;
+            double argument = scale*distance*distance;
+            xs[i] = (argument < expLowest) ? expLowest : argument;
+        }
+        #pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            values[i] = 0.25*negativeExp(xs[i]);
+        }
+    }
+}
+
+static Field gaussianWave(const Parameters &param, const UniformGrid &x, double sigma){
+    Field rho (x.size());
+    const double xmid = 0.5*(param.x2+param.x1);
+    if (sigma <= 0.0) {
+        sigma = (param.x2-param.x1)/20.0;
+    }
+    const double scale = -0.5/(sigma*sigma);
+    forEachThreadChunk(x.size(), 0, [&](size_t begin, size_t end) {
+        gaussianRange(x, xmid, scale, rho.data(), begin, end);
+    });
+    return rho;
+}
+
+//Reads the values with one pread per chunk, so each thread also places its own pages; gives false and the
+//reason in error if the file cannot be read or does not hold exactly x.size() values
+static bool fileWave(const UniformGrid &x, const std::string &filename, Field &rho, std::string &error){
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 or ::fstat(fd, &status) != 0) {
+        error = "cannot read the initial wave '" + filename + "': " + std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    if (static_cast<size_t>(status.st_size) != x.size()*sizeof(double)) {
+        error = "the initial wave '" + filename + "' holds " + std::to_string(status.st_size) + " bytes instead of "
+              + std::to_string(x.size()) + " float64 values";
+        ::close(fd);
+        return false;
+    }
+    rho = Field(x.size());
+    bool failed = false;
+    forEachThreadChunk(x.size(), 0, [&](size_t begin, size_t end) {
+        char* destination = reinterpret_cast<char*>(rho.data() + begin);
+        size_t remaining = (end - begin)*sizeof(double);
+        off_t offset = static_cast<off_t>(begin*sizeof(double));
+        while (remaining > 0) {
+            ssize_t n = ::pread(fd, destination, remaining, offset);
+            if (n <= 0) {
+                #pragma omp atomic write
+                failed = true;
+                break;
+            }
+            destination += n;
+            remaining -= static_cast<size_t>(n);
+            offset += n;
+        }
+        for (size_t i = begin; i < end; i++) {
+            rho[i] = toLittleEndian(rho[i]);
+        }
+    });
+    ::close(fd);
+    if (failed) {
+        error = "cannot read the initial wave '" + filename + "'";
+        return false;
+    }
+    return true;
+}
+
+bool initialWave(const Parameters &param, const UniformGrid &x, const InitialCondition &initial, Field &rho,
+                 std::string &error){
+    switch (initial.profile) {
+        case Profile::gaussian: rho = gaussianWave(param, x, initial.sigma); return true;
+        case Profile::file:     return fileWave(x, initial.filename, rho, error);
+        case Profile::triangle: break;
+    }
+    rho = initializeRho(param, x);
+    return true;
+}
+
+Field initialWave(const Parameters &param, const UniformGrid &x){
+    InitialCondition initial;
+    if (not param.initial.empty() and not parseInitialCondition(param.initial, initial)) {
+        std::cerr << "Error: unknown initial wave '" << param.initial
+                  << "' (expected triangle, gaussian, gaussian:SIGMA or file:PATH).\n";
+        std::exit(1);
+    }
+    Field rho;
+    std::string error;
+    if (not initialWave(param, x, initial, rho, error)) {
+        std::cerr << "Error: " << error << ".\n";
+        std::exit(1);
+    }
+    return rho;
+}
@@ -0,0 +1,35 @@
+#ifndef INITIALCONDITION_H
+#define INITIALCONDITION_H
+
+#include <string>
+#include "wave1d.h"
+
+//Shapes of the initial wave
+enum class Profile {
+    triangle,   // the original triangle of height 0.25 over the middle half of the domain, see initializeRho
+    gaussian,   // 0.25*exp(-(x-xmid)^2/(2 sigma^2)) around the middle of the domain
+    file        // ngrid little-endian float64 values read from a raw binary file
+};
+
+//Choice of the initial wave of a run
+struct InitialCondition {
+    Profile profile = Profile::triangle;
+    double sigma = 0.0;         // width of the gaussian, 0 for a twentieth of the domain
+    std::string filename;       // file of the file profile
+};
+
+//Parses "triangle", "gaussian", "gaussian:SIGMA" or "file:PATH"
+bool parseInitialCondition(const std::string &text, InitialCondition &initial);
+
+//Gives the initial wave at each of the given x values in rho. Like initializeRho, the values are computed
+//without branches in vectorized loops and first written by the threads that step them (see
+//forEachThreadChunk); gives false and the reason in error if a file cannot be read or does not hold
+//exactly x.size() values.
+bool initialWave(const Parameters &param, const UniformGrid &x, const InitialCondition &initial, Field &rho,
+                 std::string &error);
+
+//Same for the profile named by param.initial (the triangle if it is empty), for the command line tools;
+//exits if the name is invalid or the wave cannot be set up
+Field initialWave(const Parameters &param, const UniformGrid &x);
+
+#endif
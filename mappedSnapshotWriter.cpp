@@ -0,0 +1,157 @@
+//mappedSnapshotWriter.cpp
+//
+//Binary snapshot output through a memory-mapped, preallocated file
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "mappedSnapshotWriter.h"
+#include "phaseProfiler.h"
+
+//Stops the program after a failed system call, like readFile does for a bad parameter file
+static void fail(const std::string &what, const std::string &filename){
+    std::cerr << "Error: " << what << " failed for output file '" << filename << "': " << std::strerror(errno) << "\n";
+    std::exit(1);
+}
+
+//Copies n values into the mapping in little-endian byte order
+template <typename T>
+static void storeLittleEndian(char* destination, const T* values, size_t n){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < n; i++) {
+        T value = toLittleEndian(values[i]);
+        std::memcpy(destination + i*sizeof(T), &value, sizeof(T));
+    }
+#else
+    std::memcpy(destination, values, n*sizeof(T));
+#endif
+}
+
+MappedSnapshotWriter::MappedSnapshotWriter(const std::string &filename, bool float32, SyncPolicy sync, AdvicePolicy advice,
+                                           bool resume)
+  : filename(filename), float32(float32), sync(sync), advice(advice), resuming(resume)
+{}
+
+MappedSnapshotWriter::~MappedSnapshotWriter(){
+    if (data != nullptr) {
+        close();
+    }
+}
+
+void MappedSnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    header = makeBinaryHeader(param, float32 ? 4 : 8);
+    // The initial wave and one snapshot every nper steps; nper = 0 would mean an outtime shorter than a
+    // step, which Simulation rejects, and is taken as a snapshot at every step
+    capacity = param.nsteps/std::max<size_t>(param.nper, 1) + 1;
+    length = binarySnapshotOffset(header, capacity);
+
+    // Preallocate the whole file, so that writing a slot can never fail for lack of space
+    fd = ::open(filename.c_str(), O_RDWR|O_CREAT|(resuming ? 0 : O_TRUNC), 0644);
+    if (fd < 0) {
+        fail("open", filename);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        fail("ftruncate", filename);
+    }
+    int error = ::posix_fallocate(fd, 0, static_cast<off_t>(length));
+    if (error != 0 and error != EOPNOTSUPP and error != EINVAL) {
+        errno = error;
+        fail("posix_fallocate", filename);
+    }
+    void* mapping = ::mmap(nullptr, length, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        fail("mmap", filename);
+    }
+    data = static_cast<char*>(mapping);
+    if (advice == AdvicePolicy::sequential or advice == AdvicePolicy::dontneed) {
+        ::madvise(data, length, MADV_SEQUENTIAL);
+    }
+
+    // The mapped header starts out with zero snapshots
+    BinaryHeader little = headerToLittleEndian(header);
+    std::memcpy(data, &little, sizeof(little));
+    for (size_t i = 0; i < x.size(); i++) {
+        double value = toLittleEndian(x[i]);
+        std::memcpy(data + sizeof(BinaryHeader) + i*sizeof(double), &value, sizeof(value));
+    }
+    release(0, sizeof(BinaryHeader) + sizeof(double)*x.size());
+}
+
+void MappedSnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    PROFILE_SCOPE(write);
+    if (header.nsnapshots == capacity) {
+        return;  // cannot happen for snapshots taken every nper steps
+    }
+    size_t begin = binarySnapshotOffset(header, header.nsnapshots);
+    char* slot = data + begin;
+
+    BinarySnapshotHeader record;
+    record.index = toLittleEndian<uint64_t>(header.nsnapshots);
+    record.step  = toLittleEndian<uint64_t>(step);
+    record.time  = toLittleEndian(static_cast<double>(step)*header.dt);
+    std::memcpy(slot, &record, sizeof(record));
+    slot += sizeof(record);
+    if (float32) {
+        float* values = reinterpret_cast<float*>(slot);
+        for (size_t i = 0; i < header.ngrid; i++) {
+            values[i] = toLittleEndian(static_cast<float>(rho[i]));
+        }
+    } else {
+        storeLittleEndian(slot, rho.data(), header.ngrid);
+    }
+
+    // Publish the slot: readers that see the new count also see its contents
+    header.nsnapshots++;
+    uint64_t count = toLittleEndian<uint64_t>(header.nsnapshots);
+    __atomic_store_n(&reinterpret_cast<BinaryHeader*>(data)->nsnapshots, count, __ATOMIC_RELEASE);
+    release(begin, begin + binaryRecordSize(header));
+}
+
+uint64_t MappedSnapshotWriter::flush(){
+    ::msync(data, length, MS_SYNC);
+    return binarySnapshotOffset(header, header.nsnapshots);
+}
+
+void MappedSnapshotWriter::resume(uint64_t, uint64_t nsnapshots){
+    // The slots are at fixed positions, only the count needs restoring
+    header.nsnapshots = nsnapshots;
+    uint64_t count = toLittleEndian<uint64_t>(header.nsnapshots);
+    __atomic_store_n(&reinterpret_cast<BinaryHeader*>(data)->nsnapshots, count, __ATOMIC_RELEASE);
+}
+
+void MappedSnapshotWriter::release(size_t begin, size_t end){
+    // msync and madvise need page-aligned addresses
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t first = (begin/page)*page;
+    if (sync != SyncPolicy::none) {
+        ::msync(data + first, end - first, (sync == SyncPolicy::sync) ? MS_SYNC : MS_ASYNC);
+    }
+    if (advice == AdvicePolicy::dontneed) {
+        // Only whole pages that are finished may be dropped from the address space
+        size_t last = (end/page)*page;
+        if (last > first) {
+            ::madvise(data + first, last - first, MADV_DONTNEED);
+        }
+    }
+}
+
+void MappedSnapshotWriter::close(){
+    if (data == nullptr) {
+        return;
+    }
+    if (sync != SyncPolicy::none) {
+        ::msync(data, length, MS_SYNC);
+    }
+    ::munmap(data, length);
+    data = nullptr;
+    // Drop slots that were never written, e.g. when a run is cut short
+    size_t used = binarySnapshotOffset(header, header.nsnapshots);
+    if (used < length and ::ftruncate(fd, static_cast<off_t>(used)) != 0) {
+        fail("ftruncate", filename);
+    }
+    ::close(fd);
+    fd = -1;
+}
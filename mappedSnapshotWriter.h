@@ -0,0 +1,42 @@
+#ifndef MAPPEDSNAPSHOTWRITER_H
+#define MAPPEDSNAPSHOTWRITER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "snapshotWriter.h"
+
+//Writes the binary format into a memory-mapped file. Since nsteps, nper and ngrid are known before the
+//first step, writeHeader sizes the file for all snapshots and maps it; every snapshot is then copied
+//directly into its slot without a system call. The mapped BinaryHeader's nsnapshots is updated (with
+//release semantics) after each slot is complete, so a post-processing tool can map the same file
+//read-only while the run is still going and use the first nsnapshots records.
+class MappedSnapshotWriter : public SnapshotWriter {
+  public:
+    MappedSnapshotWriter(const std::string &filename, bool float32, SyncPolicy sync, AdvicePolicy advice,
+                         bool resume = false);
+    ~MappedSnapshotWriter() override;
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+    void writeSnapshot(size_t step, const Field &rho) override;
+    void close() override;
+    uint64_t flush() override;
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+  private:
+    //Applies the sync and advice policies to the byte range [begin,end) of the mapping
+    void release(size_t begin, size_t end);
+
+    std::string filename;
+    bool float32;
+    SyncPolicy sync;
+    AdvicePolicy advice;
+    bool resuming;              // keep the existing file
+    int fd = -1;
+    char* data = nullptr;       // start of the mapping
+    size_t length = 0;          // size of the mapping and the file
+    size_t capacity = 0;        // number of snapshot slots
+    BinaryHeader header;        // native byte order copy of the mapped header
+};
+
+#endif
@@ -0,0 +1,303 @@
+//parameterParser.cpp
+//
+//Parsing of parameter files from one buffer, positional or key=value
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "parameterParser.h"
+
+namespace {
+
+const char* const positionalNames[] = {"c", "tau", "x1", "x2", "runtime", "dx", "outtime", "filename"};
+const unsigned allRequired = (1u << 8) - 1;
+
+//Walks through the text line by line and the words of each line, skipping comments
+class Scanner {
+  public:
+    explicit Scanner(std::string_view text) : text(text) {}
+
+    //Gives the next word of the whole text, empty at the end
+    std::string_view word() {
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c == '#') {
+                while (pos < text.size() and text[pos] != '\n') {
+                    pos++;
+                }
+            } else if (c == '\n') {
+                line++;
+                pos++;
+            } else if (c == ' ' or c == '\t' or c == '\r') {
+                pos++;
+            } else {
+                size_t start = pos;
+                while (pos < text.size() and not isSpace(text[pos]) and text[pos] != '#') {
+                    pos++;
+                }
+                return text.substr(start, pos - start);
+            }
+        }
+        return {};
+    }
+
+    //Gives the next line without its comment and surrounding blanks, false at the end
+    bool nextLine(std::string_view &content) {
+        if (pos >= text.size()) {
+            return false;
+        }
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        content = text.substr(pos, end - pos);
+        content = content.substr(0, content.find('#'));
+        content = trim(content);
+        pos = end + 1;
+        line++;
+        return true;
+    }
+
+    size_t currentLine() const { return line; }
+
+    static std::string_view trim(std::string_view s) {
+        while (not s.empty() and isSpace(s.front())) {
+            s.remove_prefix(1);
+        }
+        while (not s.empty() and isSpace(s.back())) {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+  private:
+    static bool isSpace(char c) {
+        return c == ' ' or c == '\t' or c == '\r' or c == '\n';
+    }
+
+    std::string_view text;
+    size_t pos = 0;
+    size_t line = 1;
+};
+
+bool fail(ParameterError &error, size_t line, const char* message, std::string_view detail = {}){
+    error.badValue = false;
+    error.line = line;
+    error.message = message;
+    if (not detail.empty()) {
+        error.message.append(" '").append(detail).append("'");
+    }
+    return false;
+}
+
+bool toDouble(std::string_view word, double &value){
+    if (not word.empty() and word.front() == '+') {
+        word.remove_prefix(1);
+    }
+    std::from_chars_result result = std::from_chars(word.data(), word.data() + word.size(), value);
+    return result.ec == std::errc() and result.ptr == word.data() + word.size();
+}
+
+//Stores the value of the n-th of the required parameters (in positional order)
+bool setRequired(Parameters &param, size_t n, std::string_view word){
+    double* numbers[] = {&param.c, &param.tau, &param.x1, &param.x2, &param.runtime, &param.dx, &param.outtime};
+    if (n == 7) {
+        param.outfilename.assign(word);
+        return true;
+    }
+    return toDouble(word, *numbers[n]);
+}
+
+//Sorts one of the optional words of the positional format to the engine, precision or initial wave; any
+//other word is ignored, as text after the values always was
+void setOptional(Parameters &param, std::string_view word){
+    if (word == "float64" or word == "float32" or word == "mixed") {
+        param.precision.assign(word);
+    } else if (word == "triangle" or word.substr(0, 8) == "gaussian" or word.substr(0, 5) == "file:") {
+        param.initial.assign(word);
+    } else if (word == "serial" or word == "threaded" or word == "tiled" or word == "gpu") {
+        param.engine.assign(word);
+    } else if (word.substr(0, 7) == "engine=" and word.size() > 7) {
+        param.engine.assign(word.substr(7));
+    }
+}
+
+bool parsePositional(std::string_view text, size_t firstLine, Parameters &param, ParameterError &error){
+    Scanner scanner(text);
+    for (size_t n = 0; n < 8; n++) {
+        std::string_view word = scanner.word();
+        if (word.empty()) {
+            return fail(error, firstLine + scanner.currentLine() - 1, "missing value of", positionalNames[n]);
+        }
+        if (not setRequired(param, n, word)) {
+            return fail(error, firstLine + scanner.currentLine() - 1, "not a number:", word);
+        }
+    }
+    for (std::string_view word = scanner.word(); not word.empty(); word = scanner.word()) {
+        setOptional(param, word);
+    }
+    return true;
+}
+
+//Parses key=value lines; set marks the required keys that were given
+bool parseKeyValue(std::string_view text, size_t firstLine, Parameters &param, unsigned &set, ParameterError &error){
+    Scanner scanner(text);
+    std::string_view content;
+    while (scanner.nextLine(content)) {
+        const size_t line = firstLine + scanner.currentLine() - 2;
+        if (content.empty()) {
+            continue;
+        }
+        size_t equals = content.find('=');
+        if (equals == std::string_view::npos) {
+            return fail(error, line, "expected key = value, got", content);
+        }
+        std::string_view key = Scanner::trim(content.substr(0, equals));
+        std::string_view value = Scanner::trim(content.substr(equals + 1));
+        if (value.empty()) {
+            return fail(error, line, "missing value of", key);
+        }
+        if (key == "outfilename") {
+            key = "filename";
+        }
+        size_t n = 0;
+        while (n < 8 and key != positionalNames[n]) {
+            n++;
+        }
+        if (n < 8) {
+            if (not setRequired(param, n, value)) {
+                return fail(error, line, "not a number:", value);
+            }
+            set |= 1u << n;
+        } else if (key == "engine") {
+            param.engine.assign(value);
+        } else if (key == "precision") {
+            param.precision.assign(value);
+        } else if (key == "initial") {
+            param.initial.assign(value);
+        } else if (key == "order") {
+            std::from_chars_result result = std::from_chars(value.data(), value.data() + value.size(), param.order);
+            if (result.ec != std::errc() or result.ptr != value.data() + value.size()) {
+                return fail(error, line, "not an order:", value);
+            }
+        } else if (key == "courant") {
+            if (not toDouble(value, param.courant)) {
+                return fail(error, line, "not a number:", value);
+            }
+        } else {
+            return fail(error, line, "unknown key", key);
+        }
+    }
+    for (size_t n = 0; n < 8; n++) {
+        if (not (set & (1u << n))) {
+            return fail(error, 0, "missing key", positionalNames[n]);
+        }
+    }
+    return true;
+}
+
+//Whether the first word of the text (outside comments) contains a '='
+bool isKeyValue(std::string_view text){
+    Scanner scanner(text);
+    std::string_view word = scanner.word();
+    return word.find('=') != std::string_view::npos or scanner.word().substr(0, 1) == "=";
+}
+
+//Parses one run, key=value runs start from the values in param with the required keys in set
+bool parseOne(std::string_view text, size_t firstLine, Parameters &param, unsigned &set, ParameterError &error){
+    if (isKeyValue(text)) {
+        return parseKeyValue(text, firstLine, param, set, error) and checkParameters(param, error);
+    }
+    // A positional run gives all of its values, nothing carries over from the run before it
+    set = allRequired;
+    param = Parameters{};
+    return parsePositional(text, firstLine, param, error) and checkParameters(param, error);
+}
+
+}
+
+bool parseParameters(std::string_view text, Parameters &param, ParameterError &error){
+    unsigned set = 0;
+    return parseOne(text, 1, param, set, error);
+}
+
+bool parseParameterBatch(std::string_view text, std::vector<Parameters> &params, ParameterError &error){
+    Parameters param{};
+    unsigned set = 0;
+    size_t start = 0;
+    size_t startLine = 1;
+    size_t pos = 0;
+    size_t line = 1;
+    while (pos <= text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        bool separator = (Scanner::trim(text.substr(pos, end - pos)) == "---");
+        if (separator or end == text.size()) {
+            // Runs of nothing but comments, e.g. before the first separator, are skipped
+            std::string_view run = text.substr(start, (separator ? pos : end) - start);
+            if (not Scanner(run).word().empty()) {
+                if (not parseOne(run, startLine, param, set, error)) {
+                    return false;
+                }
+                params.push_back(param);
+            }
+            start = end + 1;
+            startLine = line + 1;
+        }
+        pos = end + 1;
+        line++;
+    }
+    return true;
+}
+
+bool checkParameters(const Parameters &param, ParameterError &error){
+    const char* problem = nullptr;
+    if (not (param.c > 0.0)) {
+        problem = "wave speed c must be postive.";
+    } else if (not (param.tau > 0.0)) {
+        problem = "damping time tau must be positive or zero";
+    } else if (param.x1 >= param.x2) {
+        problem = "x1 must be less that x2.";
+    } else if (param.dx < 0) {
+        problem = "dx must be postive.";
+    } else if (param.dx > param.x2 - param.x1) {
+        problem = "dx too large for domain.";
+    } else if (param.runtime < 0.0) {
+        problem = "runtime must be positive.";
+    } else if (param.outtime < 0.0) {
+        problem = "outtime must be positive.";
+    } else if (param.outfilename.size() == 0) {
+        problem = "no output filename given.";
+    } else if (courantLimit(param.order) == 0.0) {
+        problem = "order must be 2, 4 or 6.";
+    } else if (param.courant <= 0.0 or param.courant > courantLimit(param.order)) {
+        problem = "courant must be positive and at most the stability limit of the order (1, 0.866 or 0.8135).";
+    }
+    if (problem) {
+        fail(error, 0, problem);
+        error.badValue = true;
+        return false;
+    }
+    return true;
+}
+
+bool readWholeFile(const std::string &filename, std::string &text){
+    // A directory opens as a stream too, but has no size to read
+    std::error_code error;
+    if (not std::filesystem::is_regular_file(filename, error)) {
+        return false;
+    }
+    std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+    if (not infile) {
+        return false;
+    }
+    std::streamoff size = infile.tellg();
+    if (size < 0) {
+        return false;
+    }
+    text.resize(static_cast<size_t>(size));
+    infile.seekg(0);
+    return static_cast<bool>(infile.read(text.data(), static_cast<std::streamsize>(text.size())));
+}
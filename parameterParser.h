@@ -0,0 +1,40 @@
+#ifndef PARAMETERPARSER_H
+#define PARAMETERPARSER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "wave1d.h"
+
+//Why a parameter text was rejected; nothing is allocated unless there is an error
+struct ParameterError {
+    bool badValue = false;      // the text was read, but a value does not make sense (e.g. c <= 0)
+    size_t line = 0;            // line of the problem, 0 if it concerns the whole text
+    std::string message;
+};
+
+//Parses the parameters of one run from text in either of two formats, without exiting on errors:
+//  positional   the values of c, tau, x1, x2, runtime, dx, outtime and the output file name in this order,
+//               optionally followed by the engine (serial, threaded, tiled, gpu or engine=NAME), precision
+//               and initial wave (the waveparams.txt format); other words after the values are ignored
+//  key=value    one "key = value" per line with the keys c, tau, x1, x2, runtime, dx, outtime, filename
+//               and optionally engine, precision, initial, order and courant, in any order
+//Everything from a '#' to the end of its line is a comment. The numbers are converted with
+//std::from_chars directly from the text. Gives false and fills in error if the text is rejected;
+//the dependent parameters are not derived.
+bool parseParameters(std::string_view text, Parameters &param, ParameterError &error);
+
+//Parses a batch of runs, separated by lines consisting of "---". Every run may use either format; in
+//the key=value format only the keys that differ from the previous run need to be given, while a
+//positional run starts from the defaults. The whole
+//text is parsed in one pass, the runs are appended to params.
+bool parseParameterBatch(std::string_view text, std::vector<Parameters> &params, ParameterError &error);
+
+//Checks that the values of a run make sense, the checks readFile applies
+bool checkParameters(const Parameters &param, ParameterError &error);
+
+//Reads a whole file with a single read into text; false if it cannot be read
+bool readWholeFile(const std::string &filename, std::string &text);
+
+#endif
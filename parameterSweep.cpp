@@ -0,0 +1,372 @@
+//parameterSweep.cpp
+//
+//Runs many simulations concurrently in one process, on a work-stealing pool of threads
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <omp.h>
+#include "parameterSweep.h"
+#include "stencilKernel.h"
+#include "ensembleKernel.h"
+#include "initialCondition.h"
+#include "parameterParser.h"
+#include "asyncSnapshotWriter.h"
+
+std::vector<Parameters> readSweepList(const std::string &listfile){
+    std::ifstream list(listfile);
+    if (not list) {
+        std::cerr << "Error: sweep list '" << listfile << "' not found.\n";
+        std::exit(2);
+    }
+    std::vector<Parameters> cases;
+    std::string line;
+    while (std::getline(list, line)) {
+        if (line.empty() or line[0] == '#') {
+            continue;
+        }
+        Parameters param = readFile(line);
+        deriveParameters(param);
+        cases.push_back(param);
+    }
+    return cases;
+}
+
+std::vector<Parameters> readParameterBatch(const std::string &batchfile){
+    std::string text;
+    if (not readWholeFile(batchfile, text)) {
+        std::cerr << "Error: batch file '" << batchfile << "' not found.\n";
+        std::exit(2);
+    }
+    std::vector<Parameters> cases;
+    ParameterError error;
+    if (not parseParameterBatch(text, cases, error)) {
+        std::cerr << "Error in batch file '" << batchfile << "'";
+        if (error.line > 0) {
+            std::cerr << " (line " << error.line << ")";
+        }
+        std::cerr << ": " << error.message << "\n";
+        std::exit(1);
+    }
+    for (Parameters &param : cases) {
+        deriveParameters(param);
+    }
+    return cases;
+}
+
+bool sweepGrid(const Parameters &base, const std::vector<double> &cs, const std::vector<double> &taus,
+               std::vector<Parameters> &cases, ParameterError &error){
+    std::vector<double> cvalues = cs.empty() ? std::vector<double>{base.c} : cs;
+    std::vector<double> tauvalues = taus.empty() ? std::vector<double>{base.tau} : taus;
+    for (double c : cvalues) {
+        for (double tau : tauvalues) {
+            Parameters param = base;
+            param.c = c;
+            param.tau = tau;
+            if (not checkParameters(param, error)) {
+                return false;
+            }
+            deriveParameters(param);
+            cases.push_back(param);
+        }
+    }
+    return true;
+}
+
+bool parseValueList(const std::string &text, std::vector<double> &values){
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+    while (true) {
+        const char* comma = std::find(begin, end, ',');
+        if (begin != comma and *begin == '+') {
+            begin++;
+        }
+        double value;
+        std::from_chars_result result = std::from_chars(begin, comma, value);
+        if (result.ec != std::errc() or result.ptr != comma) {
+            return false;
+        }
+        values.push_back(value);
+        if (comma == end) {
+            return true;
+        }
+        begin = comma + 1;
+    }
+}
+
+std::string caseFilename(const std::string &filename, size_t index){
+    std::filesystem::path path(filename);
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%04zu", index);
+    std::filesystem::path name = path.stem();
+    name += number;
+    name += path.extension();
+    return (path.parent_path()/name).string();
+}
+
+//Field buffers of one worker, kept between cases and only reallocated when ngrid changes
+struct CaseBuffers {
+    Field rho;
+    Field rho_prev;
+    Field rho_next;
+    Field member;   // one member extracted from an ensemble
+};
+
+//Opens the output of one case as wave1d opens that of a single run
+static std::unique_ptr<SnapshotWriter> openCaseWriter(const OutputOptions &output, size_t asyncBuffers,
+                                                      const std::string &filename){
+    return writeInBackground(makeSnapshotWriter(output, filename), output.format, asyncBuffers);
+}
+
+//Runs one case with the serial stepping, writing its snapshots to the given file
+static void runCase(const Parameters &param, const OutputOptions &output, size_t asyncBuffers,
+                    const std::string &filename, CaseBuffers &buffers){
+    std::unique_ptr<SnapshotWriter> writer = openCaseWriter(output, asyncBuffers, filename);
+    UniformGrid x = initializeX(param);
+    Field initial = initialWave(param, x);
+    StencilKernel kernel(param);
+    Field previous = previousLevel(kernel, initial);
+    buffers.rho.assign(initial.begin(), initial.end());
+    buffers.rho_prev.assign(previous.begin(), previous.end());
+    buffers.rho_next.assign(param.ngrid, 0.0);
+
+    writer->writeHeader(param, x);
+    writer->writeSnapshot(0, buffers.rho);
+    for (size_t s = 0; s < param.nsteps; s++) {
+        timeStep(buffers.rho, buffers.rho_prev, buffers.rho_next, kernel);
+        rotateBuffers(buffers.rho_prev, buffers.rho, buffers.rho_next);
+        if ((s+1)%param.nper == 0) {
+            writer->writeSnapshot(s+1, buffers.rho);
+        }
+    }
+    writer->close();
+}
+
+//Runs one case through Simulation, for the engines and precisions the worker buffers do not cover
+static bool runSimulation(const Parameters &param, const SimulationOptions &simulation, const OutputOptions &output,
+                          size_t asyncBuffers, const std::string &filename, std::string &error){
+    std::unique_ptr<Simulation> sim = Simulation::create(param, simulation, error);
+    if (not sim) {
+        return false;
+    }
+    std::unique_ptr<SnapshotWriter> writer = openCaseWriter(output, asyncBuffers, filename);
+    writer->writeHeader(param, sim->grid());
+    sim->onSnapshot([&writer](size_t step, const Field &rho, const Field &) {
+        writer->writeSnapshot(step, rho);
+    });
+    bool finished = sim->run();
+    writer->close();
+    if (not finished) {
+        error = sim->error();
+    }
+    return finished;
+}
+
+//Runs several cases with the same ngrid, nsteps and nper in lockstep with the ensemble kernel
+static void runEnsemble(const std::vector<Parameters> &params, const OutputOptions &output, size_t asyncBuffers,
+                        const std::vector<std::string> &filenames, CaseBuffers &buffers){
+    EnsembleKernel kernel(params);
+    const size_t M = kernel.members;
+    const size_t ngrid = kernel.ngrid;
+    buffers.rho.assign(ngrid*M, 0.0);
+    buffers.rho_prev.assign(ngrid*M, 0.0);
+    buffers.rho_next.assign(ngrid*M, 0.0);
+    buffers.member.assign(ngrid, 0.0);
+
+    std::vector<std::unique_ptr<SnapshotWriter>> writers;
+    for (size_t m = 0; m < M; m++) {
+        UniformGrid x = initializeX(params[m]);
+        Field initial = initialWave(params[m], x);
+        // The initial wave is written as it was set up, like runCase and wave1d do
+        writers.push_back(openCaseWriter(output, asyncBuffers, filenames[m]));
+        writers[m]->writeHeader(params[m], x);
+        writers[m]->writeSnapshot(0, initial);
+        // Zero Dirichlet boundary conditions, the stencil never writes these rows
+        initial[0] = initial[ngrid-1] = 0.0;
+        insertMember(kernel, initial, m, buffers.rho);
+        insertMember(kernel, initial, m, buffers.rho_prev);
+    }
+
+    const Parameters &param = params[0];
+    for (size_t s = 0; s < param.nsteps; s++) {
+        ensembleStep(kernel, buffers.rho.data(), buffers.rho_prev.data(), buffers.rho_next.data());
+        rotateBuffers(buffers.rho_prev, buffers.rho, buffers.rho_next);
+        if ((s+1)%param.nper == 0) {
+            for (size_t m = 0; m < M; m++) {
+                extractMember(kernel, buffers.rho, m, buffers.member);
+                writers[m]->writeSnapshot(s+1, buffers.member);
+            }
+        }
+    }
+    for (std::unique_ptr<SnapshotWriter> &writer : writers) {
+        writer->close();
+    }
+}
+
+//Queue of batch numbers of one worker; the owner takes from the back, thieves from the front
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> cases;
+};
+
+//Takes the next batch of worker w, stealing from the other queues when its own is empty
+static bool nextCase(std::vector<WorkQueue> &queues, size_t w, size_t &next){
+    {
+        std::lock_guard<std::mutex> lock(queues[w].mutex);
+        if (not queues[w].cases.empty()) {
+            next = queues[w].cases.back();
+            queues[w].cases.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); k++) {
+        WorkQueue &victim = queues[(w + k)%queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (not victim.cases.empty()) {
+            next = victim.cases.front();
+            victim.cases.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool runSweep(std::vector<Parameters> cases, const SimulationOptions &simulation, const OutputOptions &output,
+              size_t asyncBuffers, int nworkers, const std::string &combined, size_t ensembleSize, std::string &error){
+    size_t ncases = cases.size();
+    if (ncases == 0) {
+        return true;
+    }
+
+    // Resolve the engine and precision of every case as Simulation::create does, and check its stencil
+    // before anything runs, since the serial float64 cases do not go through Simulation
+    for (size_t i = 0; i < ncases; i++) {
+        Parameters &param = cases[i];
+        param.engine = not simulation.engine.empty() ? simulation.engine
+                     : not param.engine.empty() ? param.engine : "serial";
+        param.precision = not simulation.precision.empty() ? simulation.precision
+                        : not param.precision.empty() ? param.precision : "float64";
+        if (courantLimit(param.order) == 0.0 or param.courant <= 0.0 or param.courant > courantLimit(param.order)) {
+            error = "case " + std::to_string(i) + " has no stable stencil of order " + std::to_string(param.order)
+                  + " at the Courant number " + std::to_string(param.courant);
+            return false;
+        }
+        if (param.nper == 0) {
+            error = "case " + std::to_string(i) + " has an outtime shorter than one time step";
+            return false;
+        }
+    }
+    auto buffered = [&](size_t i) { return cases[i].engine == "serial" and cases[i].precision == "float64"; };
+
+    // Output file of every case, fixed before any reordering; the headers name the final file
+    std::vector<std::string> filenames(ncases);
+    for (size_t i = 0; i < ncases; i++) {
+        filenames[i] = caseFilename(combined.empty() ? cases[i].outfilename : combined, i);
+        cases[i].outfilename = combined.empty() ? filenames[i] : combined;
+    }
+
+    // Group cases of the same grid size (and, for ensembles, the same step counts) ...
+    std::vector<size_t> order(ncases);
+    for (size_t i = 0; i < ncases; i++) {
+        order[i] = i;
+    }
+    auto key = [&](size_t i) { return std::make_tuple(cases[i].ngrid, cases[i].nsteps, cases[i].nper); };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key(a) < key(b); });
+
+    // ... into batches of up to ensembleSize cases that can step in lockstep; the ensemble kernel only has
+    // the three point stencil in float64, so cases of a higher order or on another engine run on their own
+    auto alone = [&](size_t i) { return cases[i].order > 2 or not buffered(i); };
+    std::vector<std::vector<size_t>> batches;
+    for (size_t i : order) {
+        if (batches.empty() or batches.back().size() >= std::max<size_t>(ensembleSize, 1)
+            or key(batches.back().front()) != key(i) or alone(i) or alone(batches.back().front())) {
+            batches.emplace_back();
+        }
+        batches.back().push_back(i);
+    }
+
+    // Deal the batches out in contiguous runs
+    size_t nbatches = batches.size();
+    size_t workers = (nworkers > 0) ? static_cast<size_t>(nworkers) : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::max<size_t>(1, std::min(workers, nbatches));
+    std::vector<WorkQueue> queues(workers);
+    for (size_t k = 0; k < nbatches; k++) {
+        // Reversed within a worker, since workers take from the back of their queue
+        queues[k*workers/nbatches].cases.push_front(k);
+    }
+
+    // The workers already share out the cores, so each compresses its snapshots on one thread ...
+    OutputOptions caseOutput = output;
+    if (caseOutput.compressionThreads <= 0) {
+        caseOutput.compressionThreads = 1;
+    }
+    std::mutex failures;
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; w++) {
+        threads.emplace_back([&, w] {
+            // ... and steps on one, e.g. with the threaded engine
+            omp_set_num_threads(1);
+            CaseBuffers buffers;
+            size_t next;
+            while (nextCase(queues, w, next)) {
+                const std::vector<size_t> &batch = batches[next];
+                if (batch.size() == 1 and not buffered(batch[0])) {
+                    std::string reason;
+                    if (not runSimulation(cases[batch[0]], simulation, caseOutput, asyncBuffers, filenames[batch[0]],
+                                       reason)) {
+                        std::lock_guard<std::mutex> lock(failures);
+                        if (error.empty()) {
+                            error = "case " + std::to_string(batch[0]) + ": " + reason;
+                        }
+                    }
+                } else if (batch.size() == 1) {
+                    runCase(cases[batch[0]], caseOutput, asyncBuffers, filenames[batch[0]], buffers);
+                } else {
+                    std::vector<Parameters> params;
+                    std::vector<std::string> names;
+                    for (size_t i : batch) {
+                        params.push_back(cases[i]);
+                        names.push_back(filenames[i]);
+                    }
+                    runEnsemble(params, caseOutput, asyncBuffers, names, buffers);
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    if (not error.empty()) {
+        // A combined file would miss the failed case, so the parts are dropped
+        for (size_t i = 0; i < ncases and not combined.empty(); i++) {
+            std::filesystem::remove(filenames[i]);
+        }
+        return false;
+    }
+    if (not combined.empty()) {
+        // Concatenate in case order and record where each case starts
+        std::ofstream fout(combined, std::ios::binary);
+        std::ofstream index(combined + ".idx");
+        index << "#case offset size c tau\n";
+        size_t offset = 0;
+        for (size_t i = 0; i < ncases; i++) {
+            std::ifstream part(filenames[i], std::ios::binary);
+            fout << part.rdbuf();
+            size_t size = static_cast<size_t>(std::filesystem::file_size(filenames[i]));
+            index << i << " " << offset << " " << size << " " << cases[i].c << " " << cases[i].tau << "\n";
+            offset += size;
+            part.close();
+            std::filesystem::remove(filenames[i]);
+        }
+    }
+    return error.empty();
+}
@@ -0,0 +1,49 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "snapshotWriter.h"
+#include "simulation.h"
+#include "parameterParser.h"
+
+//Reads a sweep list: one parameter file name per line (empty lines and lines starting with '#' are
+//skipped), and returns the parameters of each file with the dependent ones derived
+std::vector<Parameters> readSweepList(const std::string &listfile);
+
+//Reads a batch file of many runs separated by "---" lines in one pass (see parseParameterBatch) and
+//returns their parameters with the dependent ones derived; exits if the file is rejected
+std::vector<Parameters> readParameterBatch(const std::string &batchfile);
+
+//Appends the cases of a grid sweep to cases: a copy of base for every combination of the given c and
+//tau values (an empty list keeps the value of base), with the dependent parameters derived. Gives false
+//and the reason in error if a case fails the checks of checkParameters, e.g. for c <= 0 or tau <= 0.
+bool sweepGrid(const Parameters &base, const std::vector<double> &cs, const std::vector<double> &taus,
+               std::vector<Parameters> &cases, ParameterError &error);
+
+//Parses a comma-separated list of numbers such as "0.5,1,2" with std::from_chars, as the parameter
+//files are read; returns false if it is malformed
+bool parseValueList(const std::string &text, std::vector<double> &values);
+
+//Output file name of case index of a sweep: "results.dat" becomes "results_0003.dat"
+std::string caseFilename(const std::string &filename, size_t index);
+
+//Runs all cases in one process on nworkers threads (0 uses the number of cores). Every case steps with
+//the engine and precision of simulation, else those of its parameters, else serial in float64, as
+//Simulation::create resolves them. Serial float64 cases are sorted by ngrid and dealt out in contiguous
+//runs, so a worker mostly reuses its field buffers; the other cases run through Simulation. Idle workers
+//steal cases from the others. With ensembleSize > 1, up to that many serial float64 cases with the same
+//ngrid, nsteps and nper are stepped together by the ensemble kernel (see ensembleKernel.h).
+//Without a combined file, every case writes its own file named caseFilename(param.outfilename, index).
+//With one, the per-case outputs are concatenated into it in case order and combined + ".idx" lists
+//the offset and size of each case. The writers are opened with writeInBackground and asyncBuffers (see
+//asyncSnapshotWriter.h). Each worker steps and compresses on one OpenMP thread, unless
+//output.compressionThreads asks for more, since the workers already share out the cores. Gives false and the reason in error if a case has no stable stencil
+//(then nothing runs) or its simulation cannot be set up (then the other cases still run, but
+//no combined file is written).
+bool runSweep(std::vector<Parameters> cases, const SimulationOptions &simulation, const OutputOptions &output,
+              size_t asyncBuffers, int nworkers, const std::string &combined, size_t ensembleSize, std::string &error);
+
+#endif
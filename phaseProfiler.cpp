@@ -0,0 +1,142 @@
+//phaseProfiler.cpp
+//
+//Totals, hardware counters and the report of the optional instrumentation, see phaseProfiler.h
+#ifdef WAVE1D_PROFILE
+
+#include <iomanip>
+#include <cstring>
+#include "phaseProfiler.h"
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+PhaseTotals totals[static_cast<int>(Phase::count)];
+const char* phaseNames[] = {"run", "step", "snapshot", "format", "write"};
+const char* counterNames[profileCounters] = {"cycles", "instructions", "cache misses"};
+bool counting = false;
+
+// perf_event counters count only the thread that opened them, so every thread that times a scope opens its own
+struct ThreadCounters {
+    int fds[profileCounters] = {-1, -1, -1};
+    bool opened = false;
+    ~ThreadCounters() {
+        for (int fd : fds) {
+#if defined(__linux__)
+            if (fd >= 0) {
+                close(fd);
+            }
+#endif
+        }
+    }
+};
+thread_local ThreadCounters threadCounters;
+
+//Opens the counters of the calling thread into fds; false (and all fds -1) if any is not available
+bool openCounters(int fds[profileCounters]){
+#if defined(__linux__)
+    const uint64_t configs[profileCounters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_MISSES};
+    for (int n = 0; n < profileCounters; n++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[n];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds[n] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fds[n] < 0) {
+            for (int m = 0; m < n; m++) {
+                close(fds[m]);
+                fds[m] = -1;
+            }
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+// the tick rate is measured against the steady clock between the first timed scope and the report
+const uint64_t startTicks = profileTicks();
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+}
+
+PhaseTotals &phaseTotals(Phase phase){
+    return totals[static_cast<int>(phase)];
+}
+
+bool countersEnabled(){
+    return counting;
+}
+
+void readCounters(uint64_t values[profileCounters]){
+    ThreadCounters &counters = threadCounters;
+    if (not counters.opened) {
+        // The first timed scope of a thread opens its counters
+        counters.opened = true;
+        openCounters(counters.fds);
+    }
+    for (int n = 0; n < profileCounters; n++) {
+        values[n] = 0;
+#if defined(__linux__)
+        if (counters.fds[n] < 0 or read(counters.fds[n], &values[n], sizeof(values[n])) != sizeof(values[n])) {
+            values[n] = 0;
+        }
+#endif
+    }
+}
+
+bool enableCounters(){
+    ThreadCounters &counters = threadCounters;
+    counters.opened = true;
+    counting = openCounters(counters.fds);
+    return counting;
+}
+
+void profileReport(std::ostream &out, double pointSteps){
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double ticksPerSecond = static_cast<double>(profileTicks() - startTicks)/seconds;
+    double runSeconds = static_cast<double>(phaseTotals(Phase::run).ticks.load())/ticksPerSecond;
+
+    out << "# phase      calls     seconds   % of run";
+    if (counting) {
+        for (const char* name : counterNames) {
+            out << std::setw(16) << name;
+        }
+    }
+    out << "\n";
+    for (int p = 0; p < static_cast<int>(Phase::count); p++) {
+        const PhaseTotals &phase = totals[p];
+        double phaseSeconds = static_cast<double>(phase.ticks.load())/ticksPerSecond;
+        out << std::left << std::setw(10) << phaseNames[p] << std::right
+            << std::setw(9) << phase.calls.load()
+            << std::setw(12) << std::setprecision(4) << phaseSeconds
+            << std::setw(11) << std::setprecision(3) << ((runSeconds > 0) ? 100*phaseSeconds/runSeconds : 0.0);
+        if (counting) {
+            for (int n = 0; n < profileCounters; n++) {
+                out << std::setw(16) << phase.counters[n].load();
+            }
+        }
+        out << "\n";
+    }
+    if (not counting) {
+        out << "# hardware counters off (--counters, needs perf_event access)\n";
+    }
+
+    // Stepping is whatever the run spent outside the snapshots, whichever engine did it
+    double stepSeconds = runSeconds - static_cast<double>(phaseTotals(Phase::snapshot).ticks.load())/ticksPerSecond;
+    if (stepSeconds > 0 and pointSteps > 0) {
+        out << "# stepping " << stepSeconds << " s, " << 1e9*stepSeconds/pointSteps << " ns per point per step, ~"
+            << 6*pointSteps/stepSeconds/1e9 << " GFLOP/s\n";
+    }
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PHASEPROFILER_H
+#define PHASEPROFILER_H
+
+//Optional instrumentation of the hot paths, compiled in with -DWAVE1D_PROFILE (make PROFILE=1).
+//Without it the PROFILE_ macros expand to nothing and no profiling code is built.
+
+#ifdef WAVE1D_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// the timed phases of a run; run contains the others, snapshot contains format and write
+enum class Phase { run, step, snapshot, format, write, count };
+
+// hardware counters read per phase: cycles, instructions, cache misses
+const int profileCounters = 3;
+
+//Reads the time stamp counter, or a nanosecond clock on CPUs without one
+inline uint64_t profileTicks(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+//Totals of one phase, summed over all threads
+struct PhaseTotals {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> counters[profileCounters] = {};
+};
+
+//The totals of the given phase
+PhaseTotals &phaseTotals(Phase phase);
+
+//Whether enableCounters succeeded
+bool countersEnabled();
+
+//Current values of the hardware counters of the calling thread, which the first call on each thread
+//opens; all 0 on a thread whose counters cannot be opened
+void readCounters(uint64_t values[profileCounters]);
+
+//Opens the hardware counters (perf_event) for the calling thread, and turns on counting in every
+//thread; false if they are not available. Each timed scope then reads the counters of its own thread
+//twice, a system call each, so counters suit coarse profiling.
+bool enableCounters();
+
+//Prints calls, seconds, share of the run and the counters of every phase. pointSteps (grid points times
+//steps) gives the rate of the stencil and an estimate of its FLOP rate at 6 operations per point.
+void profileReport(std::ostream &out, double pointSteps);
+
+//Adds the time, and the change of the counters, between construction and destruction to a phase
+class ScopedPhaseTimer {
+  public:
+    explicit ScopedPhaseTimer(Phase phase) : totals(phaseTotals(phase)) {
+        if (countersEnabled()) {
+            readCounters(startCounters);
+        }
+        start = profileTicks();
+    }
+    ~ScopedPhaseTimer() {
+        uint64_t stop = profileTicks();
+        totals.ticks.fetch_add(stop - start, std::memory_order_relaxed);
+        totals.calls.fetch_add(1, std::memory_order_relaxed);
+        if (countersEnabled()) {
+            uint64_t stopCounters[profileCounters];
+            readCounters(stopCounters);
+            for (int n = 0; n < profileCounters; n++) {
+                totals.counters[n].fetch_add(stopCounters[n] - startCounters[n], std::memory_order_relaxed);
+            }
+        }
+    }
+    ScopedPhaseTimer(const ScopedPhaseTimer &) = delete;
+    ScopedPhaseTimer &operator=(const ScopedPhaseTimer &) = delete;
+  private:
+    PhaseTotals &totals;
+    uint64_t start;
+    uint64_t startCounters[profileCounters];
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+// times the rest of the enclosing scope as the given phase, e.g. PROFILE_SCOPE(step);
+#define PROFILE_SCOPE(phase) ScopedPhaseTimer PROFILE_CONCAT(profileTimer, __LINE__)(Phase::phase)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+//progressReporter.cpp
+//
+//Periodic progress records of a run on stderr, a Unix socket or a metrics file
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "progressReporter.h"
+
+ProgressReporter::ProgressReporter(const std::string &destination, double interval, const Parameters &param,
+                                   const std::atomic<size_t> &steps, size_t firstStep,
+                                   std::function<size_t()> queueDepth)
+  : destination(destination), interval(interval), nsteps(param.nsteps), ngrid(param.ngrid), dt(param.dt),
+    steps(steps), queueDepth(std::move(queueDepth)), start(std::chrono::steady_clock::now()), lastTime(start),
+    firstStep(firstStep), lastStep(firstStep)
+{
+    thread = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    if (socket >= 0) {
+        ::close(socket);
+    }
+}
+
+void ProgressReporter::run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while (not stopping) {
+        wake.wait_for(lock, interval, [this] { return stopping; });
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+void ProgressReporter::publish(){
+    auto now = std::chrono::steady_clock::now();
+    // The counter of an engine that has not started yet is still at 0
+    size_t step = std::max(steps.load(std::memory_order_relaxed), firstStep);
+    double elapsed = std::chrono::duration<double>(now - start).count();
+    double window = std::chrono::duration<double>(now - lastTime).count();
+    double rate = (window > 0) ? static_cast<double>(step - lastStep)/window : 0.0;
+    // The ETA uses the average over the whole run, which is steadier than the last interval
+    double average = (elapsed > 0) ? static_cast<double>(step - firstStep)/elapsed : 0.0;
+    double eta = (average > 0) ? static_cast<double>(nsteps - step)/average : -1.0;
+    lastTime = now;
+    lastStep = step;
+
+    std::ostringstream record;
+    record << "{\"step\": " << step << ", \"nsteps\": " << nsteps
+           << ", \"time\": " << static_cast<double>(step)*dt
+           << ", \"elapsed_s\": " << elapsed
+           << ", \"steps_per_s\": " << rate
+           << ", \"points_per_s\": " << rate*static_cast<double>(ngrid)
+           << ", \"queue_depth\": " << (queueDepth ? queueDepth() : 0)
+           << ", \"eta_s\": " << eta << "}\n";
+    send(record.str());
+}
+
+void ProgressReporter::send(const std::string &record){
+    if (destination == "stderr") {
+        std::cerr << record << std::flush;
+    } else if (destination.rfind("unix:", 0) == 0) {
+        if (socket < 0) {
+            // (Re)connect; a scheduler that is not listening yet only misses records
+            std::string path = destination.substr(5);
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+            socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (socket >= 0 and ::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                ::close(socket);
+                socket = -1;
+            }
+            unsent.clear();
+        }
+        // The rest of a partly sent record goes first, so the reader only ever sees whole lines; a record
+        // that finds the socket still full is dropped as a whole
+        if (socket >= 0 and unsent.empty()) {
+            unsent = record;
+        }
+        if (socket >= 0) {
+            ssize_t sent = ::send(socket, unsent.data(), unsent.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent >= 0) {
+                unsent.erase(0, static_cast<size_t>(sent));
+            } else if (errno != EAGAIN and errno != EWOULDBLOCK) {
+                // A closed socket is reconnected next time
+                ::close(socket);
+                socket = -1;
+            }
+        }
+    } else {
+        // Write then rename, so readers never see a partial record
+        std::string temporary = destination + ".tmp";
+        {
+            std::ofstream fout(temporary);
+            fout << record;
+        }
+        std::rename(temporary.c_str(), destination.c_str());
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "wave1d.h"
+
+//Default number of seconds between progress records
+const double defaultProgressInterval = 10.0;
+
+//Publishes a progress record of a run every interval seconds from a background thread, so the stepping
+//loop only keeps its step counter up to date. Each record is one line of JSON with the step, nsteps,
+//simulated time, steps/s and points/s over the last interval, the snapshot queue depth and the ETA.
+//The destination is "stderr", "unix:PATH" for a listening Unix stream socket (whole records are dropped
+//while it cannot take them, a partly sent one is finished first), or a file name; the file always holds the latest record and is replaced
+//atomically.
+class ProgressReporter {
+  public:
+    //Follows the step counter of an engine from firstStep, the step the run starts from (that of the
+    //checkpoint for a restart, which the engine only takes over when it starts)
+    ProgressReporter(const std::string &destination, double interval, const Parameters &param,
+                     const std::atomic<size_t> &steps, size_t firstStep, std::function<size_t()> queueDepth);
+    //Publishes a final record and stops the thread
+    ~ProgressReporter();
+    ProgressReporter(const ProgressReporter &) = delete;
+    ProgressReporter &operator=(const ProgressReporter &) = delete;
+
+  private:
+    void run();
+    void publish();
+    void send(const std::string &record);
+
+    std::string destination;
+    std::chrono::duration<double> interval;
+    size_t nsteps;
+    size_t ngrid;
+    double dt;
+    const std::atomic<size_t> &steps;
+    std::function<size_t()> queueDepth;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point lastTime;
+    size_t firstStep;       // where the run started, 0 unless it was restarted
+    size_t lastStep;
+    int socket = -1;
+    std::string unsent;     // the part of a record the socket has not taken yet
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
+#endif
@@ -0,0 +1,93 @@
+//regionSnapshotWriter.cpp
+//
+//Output of a window of the grid at a reduced resolution
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include "regionSnapshotWriter.h"
+#include "phaseProfiler.h"
+
+//Reads one bound with std::from_chars, as the parameter files are read; an empty bound keeps value
+static bool parseBound(const char* begin, const char* end, double &value){
+    if (begin == end) {
+        return true;
+    }
+    if (*begin == '+') {
+        begin++;
+    }
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() and result.ptr == end;
+}
+
+bool parseOutputRegion(const std::string &text, OutputRegion &region){
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+    return parseBound(begin, begin + colon, region.xmin) and parseBound(begin + colon + 1, end, region.xmax)
+           and region.xmin <= region.xmax;
+}
+
+size_t regionPoints(const OutputRegion &region, const UniformGrid &x){
+    size_t first = x.lowerBound(region.xmin);
+    size_t end = x.upperBound(region.xmax);
+    return (first < end) ? end - first : 0;
+}
+
+RegionSnapshotWriter::RegionSnapshotWriter(std::unique_ptr<SnapshotWriter> writer, const OutputRegion &region)
+  : writer(std::move(writer)), async(dynamic_cast<AsyncSnapshotWriter*>(this->writer.get())), region(region)
+{
+    this->region.stride = std::max<size_t>(region.stride, 1);
+}
+
+void RegionSnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    //The grid is increasing, so the region is one contiguous range of indices
+    first = x.lowerBound(region.xmin);
+    size_t end = x.upperBound(region.xmax);
+    if (first >= end) {
+        throw std::invalid_argument("no grid point lies in the output region");
+    }
+    count = (end - first + region.stride - 1)/region.stride;
+
+    UniformGrid subset = x.subset(first, end, region.stride);
+    Parameters reduced = param;
+    reduced.ngrid = count;
+    reduced.x1 = subset[0];
+    reduced.x2 = subset[count-1];
+    reduced.dx = param.dx*static_cast<double>(region.stride);
+    if (not async) {
+        selected.assign(count, 0.0);
+    }
+    writer->writeHeader(reduced, subset);
+}
+
+void RegionSnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    if (async) {
+        async->writeSelection(step, rho, first, region.stride);
+        return;
+    }
+    {
+        PROFILE_SCOPE(format);
+        const double* source = rho.data() + first;
+        const size_t stride = region.stride;
+        for (size_t i = 0; i < count; i++) {
+            selected[i] = source[i*stride];
+        }
+    }
+    writer->writeSnapshot(step, selected);
+}
+
+void RegionSnapshotWriter::close(){
+    writer->close();
+}
+
+uint64_t RegionSnapshotWriter::flush(){
+    return writer->flush();
+}
+
+void RegionSnapshotWriter::resume(uint64_t size, uint64_t nsnapshots){
+    writer->resume(size, nsnapshots);
+}
@@ -0,0 +1,59 @@
+#ifndef REGIONSNAPSHOTWRITER_H
+#define REGIONSNAPSHOTWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "snapshotWriter.h"
+#include "asyncSnapshotWriter.h"
+
+//Part of the grid that goes into the output: the points with xmin <= x <= xmax, and of those only
+//every stride-th one, starting with the first
+struct OutputRegion {
+    double xmin = -std::numeric_limits<double>::infinity();
+    double xmax = std::numeric_limits<double>::infinity();
+    size_t stride = 1;
+
+    //True if every point is written, so no RegionSnapshotWriter is needed
+    bool whole() const { return stride == 1 and xmin == -std::numeric_limits<double>::infinity()
+                                            and xmax == std::numeric_limits<double>::infinity(); }
+};
+
+//Parses "XMIN:XMAX" where either bound may be left empty, e.g. "0.5:" or ":-1"; the bounds are read with
+//std::from_chars, as the parameter files are. Gives false if the text is malformed or XMIN > XMAX.
+bool parseOutputRegion(const std::string &text, OutputRegion &region);
+
+//Number of points of the grid in the region, before the stride is applied
+size_t regionPoints(const OutputRegion &region, const UniformGrid &x);
+
+//Passes only the points of a region on to another writer. The indices are resolved once from the grid
+//in writeHeader and the underlying writer sees a smaller grid: its header gets the ngrid, x1, x2 and dx
+//of the selected points. Each snapshot is gathered into one buffer of that size, which for an
+//AsyncSnapshotWriter is its next free buffer, so the points are copied only once.
+class RegionSnapshotWriter : public SnapshotWriter {
+  public:
+    RegionSnapshotWriter(std::unique_ptr<SnapshotWriter> writer, const OutputRegion &region);
+
+    //Selects the points and writes the header of the reduced grid; the region must hold at least one
+    //point (see regionPoints), else std::invalid_argument is thrown
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+
+    void writeSnapshot(size_t step, const Field &rho) override;
+    void close() override;
+    uint64_t flush() override;
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+  private:
+    std::unique_ptr<SnapshotWriter> writer;
+    AsyncSnapshotWriter* async;   // the writer, if it writes in the background
+    OutputRegion region;
+    size_t first = 0;       // index of the first selected point
+    size_t count = 0;       // number of selected points, first + i*stride for i < count
+    Field selected;         // the gathered points, unless they go straight into the buffers of async
+};
+
+#endif
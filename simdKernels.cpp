@@ -0,0 +1,258 @@
+//simdKernels.cpp
+//
+//Vectorized versions of the leap-frog stencil and the runtime selection between them.
+//Every version evaluates (a*rho[i] + b*rho_prev[i]) + k*(rho[i-1] + rho[i+1]) in the same order as the
+//scalar reference, so results agree bit for bit as long as the compiler does not contract into FMA
+//instructions (the Makefile passes -ffp-contract=off for that reason).
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include "simdKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WAVE1D_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define WAVE1D_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+void stencilScalar(const StencilKernel &kernel, const double *__restrict rho, const double *__restrict rho_prev,
+                   double *__restrict rho_next, size_t begin, size_t end){
+    const double a = kernel.a;
+    const double b = kernel.b;
+    const double k = kernel.k;
+    for (size_t i = begin; i < end; i++) {
+        rho_next[i] = a*rho[i] + b*rho_prev[i] + k*(rho[i-1] + rho[i+1]);
+    }
+}
+
+//Number of points to handle in scalar code before rho_next+i lies on a boundary of the given number of bytes
+static size_t peelCount(const double *rho_next, size_t begin, size_t end, size_t bytes){
+    size_t misalignment = reinterpret_cast<std::uintptr_t>(rho_next + begin) % bytes;
+    size_t peel = (misalignment == 0) ? 0 : (bytes - misalignment)/sizeof(double);
+    return (peel < end - begin) ? peel : end - begin;
+}
+
+#ifdef WAVE1D_HAVE_X86
+__attribute__((target("avx2")))
+static void stencilAvx2(const StencilKernel &kernel, const double *__restrict rho, const double *__restrict rho_prev,
+                        double *__restrict rho_next, size_t begin, size_t end){
+    size_t i = begin + peelCount(rho_next, begin, end, 32);
+    stencilScalar(kernel, rho, rho_prev, rho_next, begin, i);
+    const __m256d a = _mm256_set1_pd(kernel.a);
+    const __m256d b = _mm256_set1_pd(kernel.b);
+    const __m256d k = _mm256_set1_pd(kernel.k);
+    for (; i + 4 <= end; i += 4) {
+        __m256d current   = _mm256_loadu_pd(rho + i);
+        __m256d previous  = _mm256_loadu_pd(rho_prev + i);
+        __m256d neighbors = _mm256_add_pd(_mm256_loadu_pd(rho + i - 1), _mm256_loadu_pd(rho + i + 1));
+        __m256d local     = _mm256_add_pd(_mm256_mul_pd(a, current), _mm256_mul_pd(b, previous));
+        _mm256_store_pd(rho_next + i, _mm256_add_pd(local, _mm256_mul_pd(k, neighbors)));
+    }
+    // Remainder that does not fill a whole vector
+    stencilScalar(kernel, rho, rho_prev, rho_next, i, end);
+}
+
+__attribute__((target("avx512f")))
+static void stencilAvx512(const StencilKernel &kernel, const double *__restrict rho, const double *__restrict rho_prev,
+                          double *__restrict rho_next, size_t begin, size_t end){
+    size_t i = begin + peelCount(rho_next, begin, end, 64);
+    stencilScalar(kernel, rho, rho_prev, rho_next, begin, i);
+    const __m512d a = _mm512_set1_pd(kernel.a);
+    const __m512d b = _mm512_set1_pd(kernel.b);
+    const __m512d k = _mm512_set1_pd(kernel.k);
+    for (; i + 8 <= end; i += 8) {
+        __m512d current   = _mm512_loadu_pd(rho + i);
+        __m512d previous  = _mm512_loadu_pd(rho_prev + i);
+        __m512d neighbors = _mm512_add_pd(_mm512_loadu_pd(rho + i - 1), _mm512_loadu_pd(rho + i + 1));
+        __m512d local     = _mm512_add_pd(_mm512_mul_pd(a, current), _mm512_mul_pd(b, previous));
+        _mm512_store_pd(rho_next + i, _mm512_add_pd(local, _mm512_mul_pd(k, neighbors)));
+    }
+    // Remainder that does not fill a whole vector
+    stencilScalar(kernel, rho, rho_prev, rho_next, i, end);
+}
+#endif
+
+#ifdef WAVE1D_HAVE_NEON
+static void stencilNeon(const StencilKernel &kernel, const double *__restrict rho, const double *__restrict rho_prev,
+                        double *__restrict rho_next, size_t begin, size_t end){
+    size_t i = begin + peelCount(rho_next, begin, end, 16);
+    stencilScalar(kernel, rho, rho_prev, rho_next, begin, i);
+    const float64x2_t a = vdupq_n_f64(kernel.a);
+    const float64x2_t b = vdupq_n_f64(kernel.b);
+    const float64x2_t k = vdupq_n_f64(kernel.k);
+    for (; i + 2 <= end; i += 2) {
+        float64x2_t current   = vld1q_f64(rho + i);
+        float64x2_t previous  = vld1q_f64(rho_prev + i);
+        float64x2_t neighbors = vaddq_f64(vld1q_f64(rho + i - 1), vld1q_f64(rho + i + 1));
+        float64x2_t local     = vaddq_f64(vmulq_f64(a, current), vmulq_f64(b, previous));
+        vst1q_f64(rho_next + i, vaddq_f64(local, vmulq_f64(k, neighbors)));
+    }
+    // Remainder that does not fill a whole vector
+    stencilScalar(kernel, rho, rho_prev, rho_next, i, end);
+}
+#endif
+
+SimdLevel detectSimdLevel(){
+#ifdef WAVE1D_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::avx2;
+    }
+#endif
+#ifdef WAVE1D_HAVE_NEON
+    // Advanced SIMD is mandatory on AArch64
+    return SimdLevel::neon;
+#endif
+    return SimdLevel::scalar;
+}
+
+//Whether the given level can run on this CPU
+static bool simdLevelSupported(SimdLevel level){
+    SimdLevel best = detectSimdLevel();
+    switch (level) {
+        case SimdLevel::scalar: return true;
+        case SimdLevel::avx2:   return best == SimdLevel::avx2 or best == SimdLevel::avx512;
+        case SimdLevel::avx512: return best == SimdLevel::avx512;
+        case SimdLevel::neon:   return best == SimdLevel::neon;
+    }
+    return false;
+}
+
+StencilFunction stencilFunction(SimdLevel level){
+    if (not simdLevelSupported(level)) {
+        return stencilScalar;
+    }
+    switch (level) {
+#ifdef WAVE1D_HAVE_X86
+        case SimdLevel::avx2:   return stencilAvx2;
+        case SimdLevel::avx512: return stencilAvx512;
+#endif
+#ifdef WAVE1D_HAVE_NEON
+        case SimdLevel::neon:   return stencilNeon;
+#endif
+        default:                return stencilScalar;
+    }
+}
+
+// the selection is made once when the program starts
+static SimdLevel currentLevel = detectSimdLevel();
+static StencilFunction currentStencil = stencilFunction(currentLevel);
+
+void selectSimdLevel(SimdLevel level){
+    currentLevel = simdLevelSupported(level) ? level : detectSimdLevel();
+    currentStencil = stencilFunction(currentLevel);
+}
+
+SimdLevel selectedSimdLevel(){
+    return currentLevel;
+}
+
+void applyStencilRange(const StencilKernel &kernel, const double *rho, const double *rho_prev,
+                       double *rho_next, size_t begin, size_t end){
+    if (kernel.order > 2) {
+        stencilWide(kernel, rho, rho_prev, rho_next, begin, end);
+        return;
+    }
+    currentStencil(kernel, rho, rho_prev, rho_next, begin, end);
+}
+
+//The wide stencil at point i with the weights w of order 2*Half
+template <size_t Half>
+static inline double wideUpdate(const double *w, double b, const double *rho, const double *rho_prev, size_t i){
+    double neighbours = w[1]*(rho[i-1] + rho[i+1]);
+    if (Half >= 2) {
+        neighbours += w[2]*(rho[i-2] + rho[i+2]);
+    }
+    if (Half >= 3) {
+        neighbours += w[3]*(rho[i-3] + rho[i+3]);
+    }
+    return w[0]*rho[i] + b*rho_prev[i] + neighbours;
+}
+
+// The body is written out here rather than in an inline function of stencilKernel.h, which the compiler
+// would not inline into the clones and so compile for the baseline only
+WAVE1D_TARGET_CLONES
+void stencilWide(const StencilKernel &kernel, const double *rho, const double *rho_prev, double *rho_next,
+                 size_t begin, size_t end){
+    const size_t half = kernel.order/2;
+    const double b = kernel.b;
+    // The full stencil fits at the points first..last-1
+    const size_t first = std::max(begin, half);
+    const size_t last = std::max(first, std::min(end, kernel.ngrid - half));
+    // The points near the boundaries, begin..first-1 and last..end-1, with the highest order that fits
+    const size_t edges[2][2] = {{begin, std::min(first, end)}, {last, end}};
+    for (const size_t *edge : edges) {
+        for (size_t i = edge[0]; i < edge[1]; i++) {
+            const size_t reach = std::min(std::min(i, kernel.ngrid - 1 - i), half);
+            const double *w = kernel.weights[reach-1];
+            rho_next[i] = (reach == 1) ? wideUpdate<1>(w, b, rho, rho_prev, i)
+                        : (reach == 2) ? wideUpdate<2>(w, b, rho, rho_prev, i)
+                                       : wideUpdate<3>(w, b, rho, rho_prev, i);
+        }
+    }
+    // local copies, which the vectorized loops keep in registers
+    const double w[4] = {kernel.weights[half-1][0], kernel.weights[half-1][1], kernel.weights[half-1][2],
+                         kernel.weights[half-1][3]};
+    if (half == 3) {
+        #pragma omp simd
+        for (size_t i = first; i < last; i++) {
+            rho_next[i] = wideUpdate<3>(w, b, rho, rho_prev, i);
+        }
+    } else if (half == 2) {
+        #pragma omp simd
+        for (size_t i = first; i < last; i++) {
+            rho_next[i] = wideUpdate<2>(w, b, rho, rho_prev, i);
+        }
+    } else {
+        #pragma omp simd
+        for (size_t i = first; i < last; i++) {
+            rho_next[i] = wideUpdate<1>(w, b, rho, rho_prev, i);
+        }
+    }
+}
+
+WAVE1D_TARGET_CLONES
+void stencilFloat(const StencilKernel &kernel, const float *rho, const float *rho_prev, float *rho_next,
+                  size_t begin, size_t end){
+    applyStencilAs<float, float>(kernel, rho, rho_prev, rho_next, begin, end);
+}
+
+WAVE1D_TARGET_CLONES
+void stencilMixed(const StencilKernel &kernel, const float *rho, const float *rho_prev, float *rho_next,
+                  size_t begin, size_t end){
+    applyStencilAs<float, double>(kernel, rho, rho_prev, rho_next, begin, end);
+}
+
+const char* simdLevelName(SimdLevel level){
+    switch (level) {
+        case SimdLevel::scalar: return "scalar";
+        case SimdLevel::avx2:   return "avx2";
+        case SimdLevel::avx512: return "avx512";
+        case SimdLevel::neon:   return "neon";
+    }
+    return "unknown";
+}
+
+bool parseSimdLevel(const std::string &name, SimdLevel &level){
+    if (name == "auto") {
+        level = detectSimdLevel();
+    } else if (name == "scalar") {
+        level = SimdLevel::scalar;
+    } else if (name == "avx2") {
+        level = SimdLevel::avx2;
+    } else if (name == "avx512") {
+        level = SimdLevel::avx512;
+    } else if (name == "neon") {
+        level = SimdLevel::neon;
+    } else {
+        return false;
+    }
+    return true;
+}
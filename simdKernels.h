@@ -0,0 +1,64 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <cstddef>
+#include <string>
+#include "stencilKernel.h"
+
+// compiles a function for AVX-512, AVX2 and the baseline, the widest one the CPU supports is called
+#if defined(__x86_64__)
+#define WAVE1D_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define WAVE1D_TARGET_CLONES
+#endif
+
+// instruction sets for which a vectorized stencil exists
+enum class SimdLevel { scalar, avx2, avx512, neon };
+
+// signature shared by all stencil implementations: evolves the points begin..end-1 over one time step
+typedef void (*StencilFunction)(const StencilKernel &kernel, const double *rho, const double *rho_prev,
+                                double *rho_next, size_t begin, size_t end);
+
+//Scalar reference implementation of the stencil, the vectorized versions must reproduce its results
+void stencilScalar(const StencilKernel &kernel, const double *rho, const double *rho_prev,
+                   double *rho_next, size_t begin, size_t end);
+
+//Detects the widest instruction set supported by both this build and the CPU it runs on
+SimdLevel detectSimdLevel();
+
+//Selects the stencil implementation used by applyStencilRange; unsupported levels fall back to the detected one.
+//Without a call, the detected level is used.
+void selectSimdLevel(SimdLevel level);
+
+//Returns the instruction set of the currently selected stencil implementation
+SimdLevel selectedSimdLevel();
+
+//Returns the stencil implementation for the given level (the scalar one if it is not available)
+StencilFunction stencilFunction(SimdLevel level);
+
+//Evolves the points begin..end-1 over one time step with the selected implementation, or with stencilWide
+//if the kernel is of order 4 or 6
+void applyStencilRange(const StencilKernel &kernel, const double *rho, const double *rho_prev,
+                       double *rho_next, size_t begin, size_t end);
+
+//Stencils on float time levels for the reduced precision engines, computed in float or, for the mixed
+//precision, in double (see applyStencilAs). These are compiled for AVX-512, AVX2 and the baseline and the
+//widest one the CPU supports is used, independently of selectSimdLevel.
+void stencilFloat(const StencilKernel &kernel, const float *rho, const float *rho_prev, float *rho_next,
+                  size_t begin, size_t end);
+void stencilMixed(const StencilKernel &kernel, const float *rho, const float *rho_prev, float *rho_next,
+                  size_t begin, size_t end);
+
+//Evolves the points begin..end-1 over one time step with the stencil of kernel.order (see StencilKernel). A
+//point closer to the boundary than the stencil reaches uses the highest order that fits, i.e. points 1 and
+//ngrid-2 are always updated at second order and, for order 6, points 2 and ngrid-3 at fourth order. The
+//result of a point does not depend on begin and end, so the range may be split up in any way. Compiled like
+//stencilFloat for AVX-512, AVX2 and the baseline.
+void stencilWide(const StencilKernel &kernel, const double *rho, const double *rho_prev, double *rho_next,
+                 size_t begin, size_t end);
+
+//Converts between levels and their names ("scalar", "avx2", "avx512", "neon"); parsing also accepts "auto"
+const char* simdLevelName(SimdLevel level);
+bool parseSimdLevel(const std::string &name, SimdLevel &level);
+
+#endif
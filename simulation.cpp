@@ -0,0 +1,125 @@
+//simulation.cpp
+//
+//A run of the wave equation driven through callbacks, without file I/O
+#include <algorithm>
+#include <utility>
+#include "simulation.h"
+#include "phaseProfiler.h"
+
+std::unique_ptr<Simulation> Simulation::create(const Parameters &param, const SimulationOptions &options,
+                                               std::string &error){
+    std::string engineName = not options.engine.empty() ? options.engine
+                           : not param.engine.empty() ? param.engine : "serial";
+    std::string precision = not options.precision.empty() ? options.precision
+                          : not param.precision.empty() ? param.precision : "float64";
+    const std::string &initialName = not options.initial.empty() ? options.initial : param.initial;
+
+    if (courantLimit(param.order) == 0.0) {
+        error = "no stencil of order " + std::to_string(param.order) + " (expected 2, 4 or 6)";
+        return nullptr;
+    }
+    if (param.courant <= 0.0 or param.courant > courantLimit(param.order)) {
+        error = "Courant number " + std::to_string(param.courant) + " outside (0, "
+              + std::to_string(courantLimit(param.order)) + "], where the order "
+              + std::to_string(param.order) + " stencil is stable";
+        return nullptr;
+    }
+    if (param.nper == 0) {
+        error = "outtime " + std::to_string(param.outtime) + " is shorter than one time step ("
+              + std::to_string(param.dt) + ")";
+        return nullptr;
+    }
+    EngineOptions engineOptions = options.engineOptions;
+    if (not parsePrecision(precision, engineOptions.precision)) {
+        error = "unknown precision '" + precision + "' (expected float64, float32 or mixed)";
+        return nullptr;
+    }
+    InitialCondition initial;
+    if (not initialName.empty() and not parseInitialCondition(initialName, initial)) {
+        error = "unknown initial wave '" + initialName
+              + "' (expected triangle, gaussian, gaussian:SIGMA or file:PATH)";
+        return nullptr;
+    }
+    std::unique_ptr<SteppingEngine> engine = makeEngine(engineName, engineOptions);
+    if (not engine and engineOptions.precision != Precision::float64) {
+        error = "stepping engine '" + engineName + "' cannot step in " + precision
+              + " (the serial and threaded engines can)";
+        return nullptr;
+    }
+    if (engine and param.order > 2 and not engine->capabilities().wideStencils) {
+        error = (engineOptions.precision != Precision::float64)
+              ? "the order " + std::to_string(param.order) + " stencil only steps in float64"
+              : "stepping engine '" + engineName + "' cannot step the order " + std::to_string(param.order)
+                + " stencil (the serial and threaded engines can)";
+        return nullptr;
+    }
+    if (not engine) {
+        error = "stepping engine '" + engineName + "' is unknown or cannot run here (available:";
+        for (const std::string &name : engineNames()) {
+            error += " " + name;
+        }
+        error += "; gpu needs a build with GPU support and a GPU device)";
+        return nullptr;
+    }
+    // The initial wave is set up here, where a file that cannot be read can still be reported
+    UniformGrid x = initializeX(param);
+    Field rho;
+    if (not initialWave(param, x, initial, rho, error)) {
+        return nullptr;
+    }
+    // The parameters keep the settings the run steps with, e.g. for a checkpoint to restart with them
+    Parameters resolved = param;
+    resolved.engine = engineName;
+    resolved.precision = precision;
+    resolved.initial = initialName.empty() ? "triangle" : initialName;
+    return std::unique_ptr<Simulation>(new Simulation(resolved, x, std::move(rho), std::move(engine)));
+}
+
+Simulation::Simulation(const Parameters &param, const UniformGrid &x, Field rho, std::unique_ptr<SteppingEngine> engine)
+  : param_(param), x_(x), kernel_(param), engine_(std::move(engine)), rho_(std::move(rho))
+{}
+
+void Simulation::onSnapshot(SnapshotCallback callback){
+    callbacks_.push_back(std::move(callback));
+}
+
+void Simulation::resume(Field rho, Field rho_prev, size_t step){
+    rho_ = std::move(rho);
+    rho_prev_ = std::move(rho_prev);
+    step_ = step;
+    resumed_ = true;
+}
+
+void Simulation::dispatch(size_t step, const Field &rho, const Field &rho_prev) const {
+    PROFILE_SCOPE(snapshot);
+    for (const SnapshotCallback &callback : callbacks_) {
+        callback(step, rho, rho_prev);
+    }
+}
+
+bool Simulation::advance(size_t last){
+    if (not started_) {
+        // The initial wave goes to the callbacks as it was set up, before the engine zeroes its boundaries
+        if (not resumed_) {
+            rho_prev_ = previousLevel(kernel_, rho_);
+            dispatch(0, rho_, rho_prev_);
+        }
+        engine_->init(kernel_, std::move(rho_), std::move(rho_prev_), step_);
+        started_ = true;
+    }
+    last = std::min(last, param_.nsteps);
+    if (not engine_->error().empty()) {
+        return false;
+    }
+    if (step_ >= last) {
+        return true;
+    }
+    engine_->evolve(step_, last, param_.nper, [this](size_t step, const Field &rho, const Field &rho_prev) {
+        dispatch(step, rho, rho_prev);
+    });
+    if (not engine_->error().empty()) {
+        return false;
+    }
+    step_ = last;
+    return true;
+}
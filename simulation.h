@@ -0,0 +1,90 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "stencilKernel.h"
+#include "steppingEngine.h"
+#include "initialCondition.h"
+
+//How a simulation steps, besides its physical parameters; every empty name is taken from the parameters
+struct SimulationOptions {
+    std::string engine;             // registered engine name, else param.engine, else "serial"
+    std::string precision;          // "float64", "float32" or "mixed", else param.precision, else float64
+    std::string initial;            // initial wave (see parseInitialCondition), else param.initial
+    EngineOptions engineOptions;    // its precision is replaced by the one chosen above
+};
+
+//One run of the damped wave equation inside the calling program, the core of the library libwave1d.
+//It does no file I/O of its own: consumers register callbacks, which are called at every nper-th step
+//(step 0 included) with read-only views of the wave and of the wave one step earlier. The views are
+//the engine's own time levels where it keeps them in host Fields, and are valid only during the call;
+//copy whatever has to outlive it. A consumer of the library would, for instance,
+//
+//    Parameters param;
+//    ParameterError perror;
+//    parseParameters(text, param, perror);
+//    deriveParameters(param);
+//    std::string error;
+//    std::unique_ptr<Simulation> sim = Simulation::create(param, SimulationOptions(), error);
+//    sim->onSnapshot([](size_t step, const Field &rho, const Field &) { ... });
+//    sim->run();
+class Simulation {
+  public:
+    //Sets up a run of the given (derived) parameters; gives nullptr and the reason in error if the
+    //options name an unknown engine, precision or initial wave, or an engine that cannot run here or cannot
+    //step the stencil of param.order, if param.courant is beyond the stability limit, if param.outtime is
+    //shorter than one time step (nper = 0), or if the initial wave cannot be read from its file. Nothing in
+    //a simulation exits the program.
+    static std::unique_ptr<Simulation> create(const Parameters &param, const SimulationOptions &options,
+                                              std::string &error);
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+
+    //The parameters of the run, with the engine, precision and initial wave it was created with
+    const Parameters &parameters() const { return param_; }
+    const UniformGrid &grid() const { return x_; }
+    //The engine, e.g. to follow its progress or to fetch its state for a checkpoint
+    SteppingEngine &engine() { return *engine_; }
+
+    //Adds a callback for the snapshots; callbacks are called in the order they were added
+    void onSnapshot(SnapshotCallback callback);
+
+    //Continues an interrupted run from its state after the given step instead of the initial wave;
+    //the snapshot at that step is not passed to the callbacks again. Only before the first advance.
+    void resume(Field rho, Field rho_prev, size_t step);
+
+    //Advances the wave up to step last (at most param.nsteps), calling the callbacks on the way. The
+    //first advance of a run from step 0 also passes the initial wave to them. Gives false if the engine
+    //failed (see error), after which the run cannot continue.
+    bool advance(size_t last);
+    //Advances the wave to the end of the run
+    bool run() { return advance(param_.nsteps); }
+    //Why the engine stopped stepping, empty unless advance gave false
+    const std::string &error() const { return engine_->error(); }
+
+    //Number of time steps taken so far
+    size_t step() const { return step_; }
+    bool finished() const { return step_ >= param_.nsteps; }
+
+  private:
+    Simulation(const Parameters &param, const UniformGrid &x, Field rho, std::unique_ptr<SteppingEngine> engine);
+    void dispatch(size_t step, const Field &rho, const Field &rho_prev) const;
+
+    Parameters param_;
+    UniformGrid x_;
+    StencilKernel kernel_;
+    std::unique_ptr<SteppingEngine> engine_;
+    std::vector<SnapshotCallback> callbacks_;
+    Field rho_;                     // state to start from (the initial wave unless resumed), handed to the
+                                    // engine at the first advance
+    Field rho_prev_;
+    size_t step_ = 0;
+    bool started_ = false;
+    bool resumed_ = false;
+};
+
+#endif
@@ -0,0 +1,169 @@
+//snapshotCodecs.cpp
+//
+//Compression schemes for snapshot values
+#include <cmath>
+#include <cstring>
+#include "snapshotCodecs.h"
+
+uint32_t LosslessCodec::id() const{
+    return codecLossless;
+}
+
+size_t LosslessCodec::maxEncodedSize(size_t n) const{
+    return (n+1)/2 + 8*n;
+}
+
+//Number of bytes left of a 64-bit word after dropping its zero high-order bytes
+static unsigned significantBytes(uint64_t word){
+    return (word == 0) ? 0 : 8 - static_cast<unsigned>(__builtin_clzll(word))/8;
+}
+
+void LosslessCodec::encode(const double* values, size_t n, std::vector<unsigned char> &out) const{
+    out.resize(maxEncodedSize(n));
+    unsigned char* end = out.data();
+    uint64_t previous = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        unsigned char* control = end++;
+        *control = 0;
+        for (size_t j = i; j < i+2 and j < n; j++) {
+            uint64_t bits;
+            std::memcpy(&bits, &values[j], sizeof(bits));
+            uint64_t word = bits ^ previous;
+            previous = bits;
+            unsigned count = significantBytes(word);
+            *control = static_cast<unsigned char>(*control | (count << (j == i ? 4 : 0)));
+            for (unsigned b = 0; b < count; b++) {
+                *end++ = static_cast<unsigned char>(word >> (8*b));
+            }
+        }
+    }
+    out.resize(static_cast<size_t>(end - out.data()));
+}
+
+bool LosslessCodec::decode(const unsigned char* data, size_t size, double* values, size_t n) const{
+    const unsigned char* end = data + size;
+    uint64_t previous = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        if (data == end) {
+            return false;
+        }
+        unsigned char control = *data++;
+        for (size_t j = i; j < i+2 and j < n; j++) {
+            unsigned count = (j == i) ? (control >> 4) : (control & 0xf);
+            if (count > 8 or static_cast<size_t>(end - data) < count) {
+                return false;
+            }
+            uint64_t word = 0;
+            for (unsigned b = 0; b < count; b++) {
+                word |= static_cast<uint64_t>(*data++) << (8*b);
+            }
+            previous ^= word;
+            std::memcpy(&values[j], &previous, sizeof(previous));
+        }
+    }
+    return data == end;
+}
+
+//Zigzag code that stands for no difference but for a raw 8-byte value that follows it. The multiples
+//are clamped to +-4e18, so no difference of two of them has this code.
+const uint64_t lossyEscape = ~uint64_t(0);
+
+LossyCodec::LossyCodec(double tolerance)
+  : step(2.0*tolerance*(1.0 - 1e-12)), tolerance(tolerance)  // rounding to the nearest multiple is within tolerance
+{}                                                           // but for the rounding errors, checked in encode
+
+uint32_t LossyCodec::id() const{
+    return codecLossy;
+}
+
+size_t LossyCodec::maxEncodedSize(size_t n) const{
+    return 18*n;
+}
+
+//Appends the variable-length code of a zigzag value
+static unsigned char* putVarint(unsigned char* end, uint64_t zigzag){
+    while (zigzag >= 0x80) {
+        *end++ = static_cast<unsigned char>(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    *end++ = static_cast<unsigned char>(zigzag);
+    return end;
+}
+
+void LossyCodec::encode(const double* values, size_t n, std::vector<unsigned char> &out) const{
+    out.resize(maxEncodedSize(n));
+    unsigned char* end = out.data();
+    int64_t previous = 0;
+    for (size_t i = 0; i < n; i++) {
+        // Values too large for the integer range are clamped, and then escaped below
+        double multiple = std::fmax(std::fmin(std::nearbyint(values[i]/step), 4e18), -4e18);
+        int64_t q = static_cast<int64_t>(multiple);
+        // The division and the decoder's multiplication both round, which can put the decoded value
+        // just beyond the tolerance; the next multiple towards the value may still be within it
+        double decoded = static_cast<double>(q)*step;
+        if (not (std::fabs(decoded - values[i]) <= tolerance)) {
+            q += (decoded < values[i]) ? 1 : -1;
+            decoded = static_cast<double>(q)*step;
+        }
+        if (not (std::fabs(decoded - values[i]) <= tolerance)) {
+            // No multiple is close enough (huge or non-finite values): store the value itself
+            end = putVarint(end, lossyEscape);
+            std::memcpy(end, &values[i], sizeof(double));
+            end += sizeof(double);
+            continue;
+        }
+        uint64_t delta = static_cast<uint64_t>(q) - static_cast<uint64_t>(previous);
+        previous = q;
+        // Zigzag, so that small negative differences also get short codes
+        end = putVarint(end, (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63));
+    }
+    out.resize(static_cast<size_t>(end - out.data()));
+}
+
+bool LossyCodec::decode(const unsigned char* data, size_t size, double* values, size_t n) const{
+    const unsigned char* end = data + size;
+    uint64_t previous = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t zigzag = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            if (data == end or shift > 63) {
+                return false;
+            }
+            unsigned char byte = *data++;
+            zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        if (zigzag == lossyEscape) {
+            if (static_cast<size_t>(end - data) < sizeof(double)) {
+                return false;
+            }
+            std::memcpy(&values[i], data, sizeof(double));
+            data += sizeof(double);
+            continue;
+        }
+        uint64_t delta = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+        previous += delta;
+        values[i] = static_cast<double>(static_cast<int64_t>(previous))*step;
+    }
+    return data == end;
+}
+
+std::unique_ptr<SnapshotCodec> makeSnapshotCodec(const std::string &name, double tolerance){
+    if (name == "lossless") {
+        return std::make_unique<LosslessCodec>();
+    } else if (name == "lossy" and tolerance > 0.0) {
+        return std::make_unique<LossyCodec>(tolerance);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<SnapshotCodec> makeSnapshotCodec(uint32_t id, double tolerance){
+    if (id == codecLossless) {
+        return std::make_unique<LosslessCodec>();
+    } else if (id == codecLossy and tolerance > 0.0) {
+        return std::make_unique<LossyCodec>(tolerance);
+    }
+    return nullptr;
+}
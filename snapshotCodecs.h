@@ -0,0 +1,68 @@
+#ifndef SNAPSHOTCODECS_H
+#define SNAPSHOTCODECS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// identifiers stored in the codec field of BinaryHeader
+const uint32_t codecNone     = 0;
+const uint32_t codecLossless = 1;
+const uint32_t codecLossy    = 2;
+
+//Default number of values per independently compressed block
+const size_t defaultCompressionBlock = 65536;
+
+//Interface of the compression schemes for blocks of snapshot values
+class SnapshotCodec {
+  public:
+    virtual ~SnapshotCodec() = default;
+
+    //Identifier written to the file header
+    virtual uint32_t id() const = 0;
+
+    //Largest number of bytes encode can produce for n values
+    virtual size_t maxEncodedSize(size_t n) const = 0;
+
+    //Replaces the contents of out with the encoding of the n values
+    virtual void encode(const double* values, size_t n, std::vector<unsigned char> &out) const = 0;
+
+    //Decodes n values from size bytes, returns false if the data is malformed
+    virtual bool decode(const unsigned char* data, size_t size, double* values, size_t n) const = 0;
+};
+
+//Lossless: each value is XORed with its predecessor, which for smooth or zero regions leaves mostly
+//zero high-order bytes, and only the remaining low-order bytes are stored. Two 4-bit byte counts
+//share one control byte, so a run of zeros costs half a byte per value.
+class LosslessCodec : public SnapshotCodec {
+  public:
+    uint32_t id() const override;
+    size_t maxEncodedSize(size_t n) const override;
+    void encode(const double* values, size_t n, std::vector<unsigned char> &out) const override;
+    bool decode(const unsigned char* data, size_t size, double* values, size_t n) const override;
+};
+
+//Error-bounded lossy: values are rounded to integer multiples of a step just below 2*tolerance, so
+//every value is reproduced to within the given absolute tolerance, and the differences of successive
+//multiples are stored as zigzag variable-length integers (one byte for small differences). Values no
+//multiple reproduces that closely (beyond the integer range, or not finite) are stored unchanged.
+class LossyCodec : public SnapshotCodec {
+  public:
+    explicit LossyCodec(double tolerance);
+    uint32_t id() const override;
+    size_t maxEncodedSize(size_t n) const override;
+    void encode(const double* values, size_t n, std::vector<unsigned char> &out) const override;
+    bool decode(const unsigned char* data, size_t size, double* values, size_t n) const override;
+
+  private:
+    double step;
+    double tolerance;
+};
+
+//Creates a codec by name ("lossless" or "lossy") or by its identifier; returns nullptr if unknown
+std::unique_ptr<SnapshotCodec> makeSnapshotCodec(const std::string &name, double tolerance);
+std::unique_ptr<SnapshotCodec> makeSnapshotCodec(uint32_t id, double tolerance);
+
+#endif
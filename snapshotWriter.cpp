@@ -0,0 +1,300 @@
+//snapshotWriter.cpp
+//
+//Output formats for the snapshots of the wave
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include "snapshotWriter.h"
+#include "mappedSnapshotWriter.h"
+#include "compressedSnapshotWriter.h"
+#include "phaseProfiler.h"
+
+//Longest text std::to_chars produces for a double of at most 17 digits, e.g. "-2.2250738585072014e-308"
+static const size_t maxNumberLength = 32;
+
+TextSnapshotWriter::TextSnapshotWriter(const std::string &filename, bool resume)
+  : fout(filename, outputMode(resume))
+{}
+
+void TextSnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    this->param = param;
+    this->x.emplace(x);
+    //Save parameters in first lines of the file
+    writeParameters(param, fout);
+}
+
+void TextSnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    if (step == 0) {
+        fout << "\n#t = " << 0.0 << "\n";
+    } else {
+        fout << "\n\n# t = " << static_cast<double>(step)*param.dt << "\n";
+    }
+    printX(fout, rho, *x, param);
+}
+
+void TextSnapshotWriter::close(){
+    fout.close();
+}
+
+uint64_t TextSnapshotWriter::flush(){
+    fout.flush();
+    return static_cast<uint64_t>(fout.tellp());
+}
+
+void TextSnapshotWriter::resume(uint64_t size, uint64_t){
+    fout.seekp(static_cast<std::streamoff>(size));
+}
+
+FastTextSnapshotWriter::FastTextSnapshotWriter(const std::string &filename, int precision, bool resume)
+  : fout(filename, outputMode(resume)), precision(precision)
+{}
+
+char* FastTextSnapshotWriter::format(char* end, double value) const{
+    // The buffer is sized for the longest number of at most maxTextPrecision digits, so the conversion
+    // cannot run out of space; should it ever, the shortest form (which always fits) is written instead
+    std::to_chars_result result = (precision == shortestPrecision)
+        ? std::to_chars(end, end + maxNumberLength, value)
+        : std::to_chars(end, end + maxNumberLength, value, std::chars_format::general, precision);
+    if (result.ec != std::errc()) {
+        result = std::to_chars(end, end + maxNumberLength, value);
+    }
+    return result.ptr;
+}
+
+void FastTextSnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    //The parameter lines are written only once, so the stream formatting is kept for them
+    std::ostringstream header;
+    writeParameters(param, header);
+    std::string text = header.str();
+    fout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    dt = param.dt;
+
+    //Format the constant x column once, keeping only the text and one length byte per point
+    xtext.resize(x.size()*(maxNumberLength+1));
+    xlength.resize(x.size());
+    char* end = xtext.data();
+    for (size_t i = 0; i < x.size(); i++) {
+        char* begin = end;
+        end = format(end, x[i]);
+        *end++ = ' ';
+        xlength[i] = static_cast<uint8_t>(end - begin);
+    }
+    xtext.resize(static_cast<size_t>(end - xtext.data()));
+    xtext.shrink_to_fit();
+
+    //Room for the time line, the x column and every rho value with its newline
+    buffer.resize(64 + xtext.size() + x.size()*(maxNumberLength+1));
+}
+
+void FastTextSnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    static const char initial[] = "\n#t = ";
+    static const char later[] = "\n\n# t = ";
+    char* end = buffer.data();
+    if (step == 0) {
+        end = std::copy(initial, initial + sizeof(initial) - 1, end);
+        end = format(end, 0.0);
+    } else {
+        end = std::copy(later, later + sizeof(later) - 1, end);
+        end = format(end, static_cast<double>(step)*dt);
+    }
+    *end++ = '\n';
+    {
+        PROFILE_SCOPE(format);
+        const char* xs = xtext.data();
+        for (size_t i = 0; i < xlength.size(); i++) {
+            end = std::copy(xs, xs + xlength[i], end);
+            xs += xlength[i];
+            end = format(end, rho[i]);
+            *end++ = '\n';
+        }
+    }
+    PROFILE_SCOPE(write);
+    fout.write(buffer.data(), end - buffer.data());
+}
+
+void FastTextSnapshotWriter::close(){
+    fout.close();
+}
+
+uint64_t FastTextSnapshotWriter::flush(){
+    fout.flush();
+    return static_cast<uint64_t>(fout.tellp());
+}
+
+void FastTextSnapshotWriter::resume(uint64_t size, uint64_t){
+    fout.seekp(static_cast<std::streamoff>(size));
+}
+
+BinaryHeader makeBinaryHeader(const Parameters &param, uint32_t elementSize){
+    BinaryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "WAVE1D", 6);
+    header.version     = binaryFormatVersion;
+    header.elementSize = elementSize;
+    header.c           = param.c;
+    header.tau         = param.tau;
+    header.x1          = param.x1;
+    header.x2          = param.x2;
+    header.runtime     = param.runtime;
+    header.dx          = param.dx;
+    header.outtime     = param.outtime;
+    std::strncpy(header.outfilename, param.outfilename.c_str(), sizeof(header.outfilename)-1);
+    header.ngrid       = param.ngrid;
+    header.dt          = param.dt;
+    header.nsteps      = param.nsteps;
+    header.nper        = param.nper;
+    header.nsnapshots  = 0;
+    return header;
+}
+
+BinaryHeader headerToLittleEndian(BinaryHeader header){
+    header.version     = toLittleEndian(header.version);
+    header.elementSize = toLittleEndian(header.elementSize);
+    header.c           = toLittleEndian(header.c);
+    header.tau         = toLittleEndian(header.tau);
+    header.x1          = toLittleEndian(header.x1);
+    header.x2          = toLittleEndian(header.x2);
+    header.runtime     = toLittleEndian(header.runtime);
+    header.dx          = toLittleEndian(header.dx);
+    header.outtime     = toLittleEndian(header.outtime);
+    header.ngrid       = toLittleEndian(header.ngrid);
+    header.dt          = toLittleEndian(header.dt);
+    header.nsteps      = toLittleEndian(header.nsteps);
+    header.nper        = toLittleEndian(header.nper);
+    header.nsnapshots  = toLittleEndian(header.nsnapshots);
+    header.codec       = toLittleEndian(header.codec);
+    header.blockPoints = toLittleEndian(header.blockPoints);
+    header.tolerance   = toLittleEndian(header.tolerance);
+    return header;
+}
+
+//Writes n values in little-endian byte order, converting through the given buffer if needed
+template <typename T>
+static void writeLittleEndian(std::ofstream &fout, const T* values, size_t n, std::vector<T> &buffer){
+    PROFILE_SCOPE(write);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    buffer.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        buffer[i] = toLittleEndian(values[i]);
+    }
+    values = buffer.data();
+#else
+    (void) buffer;
+#endif
+    fout.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(n*sizeof(T)));
+}
+
+void writeGridLittleEndian(std::ostream &fout, const UniformGrid &x){
+    PROFILE_SCOPE(write);
+    double block[1024];
+    for (size_t begin = 0; begin < x.size(); begin += 1024) {
+        size_t n = std::min<size_t>(1024, x.size() - begin);
+        for (size_t i = 0; i < n; i++) {
+            block[i] = toLittleEndian(x[begin + i]);
+        }
+        fout.write(reinterpret_cast<const char*>(block), static_cast<std::streamsize>(n*sizeof(double)));
+    }
+}
+
+BinarySnapshotWriter::BinarySnapshotWriter(const std::string &filename, bool float32, bool resume)
+  : fout(filename, outputMode(resume)), float32(float32)
+{}
+
+void BinarySnapshotWriter::writeHeader(const Parameters &param, const UniformGrid &x){
+    header = makeBinaryHeader(param, float32 ? 4 : 8);
+    BinaryHeader little = headerToLittleEndian(header);
+    fout.write(reinterpret_cast<const char*>(&little), sizeof(little));
+    writeGridLittleEndian(fout, x);
+    if (float32) {
+        single.resize(header.ngrid);
+    }
+}
+
+void BinarySnapshotWriter::writeSnapshot(size_t step, const Field &rho){
+    BinarySnapshotHeader record;
+    record.index = toLittleEndian<uint64_t>(header.nsnapshots);
+    record.step  = toLittleEndian<uint64_t>(step);
+    record.time  = toLittleEndian(static_cast<double>(step)*header.dt);
+    fout.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    if (float32) {
+        for (size_t i = 0; i < header.ngrid; i++) {
+            single[i] = static_cast<float>(rho[i]);
+        }
+        writeLittleEndian(fout, single.data(), single.size(), swappedSingle);
+    } else {
+        writeLittleEndian(fout, rho.data(), header.ngrid, swapped);
+    }
+    header.nsnapshots++;
+}
+
+void BinarySnapshotWriter::close(){
+    // Record the number of snapshots now that it is known
+    BinaryHeader little = headerToLittleEndian(header);
+    fout.seekp(0);
+    fout.write(reinterpret_cast<const char*>(&little), sizeof(little));
+    fout.close();
+}
+
+uint64_t BinarySnapshotWriter::flush(){
+    // The header still counts zero snapshots, close fills in the number
+    fout.flush();
+    return static_cast<uint64_t>(fout.tellp());
+}
+
+void BinarySnapshotWriter::resume(uint64_t size, uint64_t nsnapshots){
+    header.nsnapshots = nsnapshots;
+    fout.seekp(static_cast<std::streamoff>(size));
+}
+
+std::unique_ptr<SnapshotWriter> makeSnapshotWriter(const OutputOptions &options, const std::string &filename){
+    if (options.format == "text") {
+        if (options.precision != shortestPrecision and (options.precision < 1 or options.precision > maxTextPrecision)) {
+            return nullptr;
+        }
+        return std::make_unique<FastTextSnapshotWriter>(filename, options.precision, options.resume);
+    } else if (options.format == "text-stream") {
+        return std::make_unique<TextSnapshotWriter>(filename, options.resume);
+    } else if (options.format == "binary") {
+        return std::make_unique<BinarySnapshotWriter>(filename, options.float32, options.resume);
+    } else if (options.format == "mapped") {
+        return std::make_unique<MappedSnapshotWriter>(filename, options.float32, options.sync, options.advice,
+                                                      options.resume);
+    } else if (options.format == "compressed") {
+        std::unique_ptr<SnapshotCodec> codec = makeSnapshotCodec(options.codec, options.tolerance);
+        if (codec) {
+            return std::make_unique<CompressedSnapshotWriter>(filename, std::move(codec), options.tolerance,
+                                                              options.compressionBlock, options.compressionThreads,
+                                                              options.resume);
+        }
+    }
+    return nullptr;
+}
+
+bool parseSyncPolicy(const std::string &name, SyncPolicy &policy){
+    if (name == "none") {
+        policy = SyncPolicy::none;
+    } else if (name == "async") {
+        policy = SyncPolicy::async;
+    } else if (name == "sync") {
+        policy = SyncPolicy::sync;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseAdvicePolicy(const std::string &name, AdvicePolicy &policy){
+    if (name == "normal") {
+        policy = AdvicePolicy::normal;
+    } else if (name == "sequential") {
+        policy = AdvicePolicy::sequential;
+    } else if (name == "dontneed") {
+        policy = AdvicePolicy::dontneed;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,203 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "snapshotCodecs.h"
+
+//Common interface of the output formats. A run calls writeHeader once, then writeSnapshot for the
+//initial wave (step 0) and every nper steps, and finally close. A restarted run instead continues the
+//file of the interrupted one: the writer is created with resume set, so the file is not truncated,
+//and writeHeader is followed by resume instead of the initial snapshot.
+class SnapshotWriter {
+  public:
+    virtual ~SnapshotWriter() = default;
+
+    //Writes everything that precedes the first snapshot
+    virtual void writeHeader(const Parameters &param, const UniformGrid &x) = 0;
+
+    //Writes the wave rho as it is after the given number of steps
+    virtual void writeSnapshot(size_t step, const Field &rho) = 0;
+
+    //Completes and closes the output file
+    virtual void close() = 0;
+
+    //Hands everything written so far to the operating system and gives the size of the output in bytes,
+    //which together with the number of snapshots is where a restart continues (see checkpoint.h)
+    virtual uint64_t flush() = 0;
+
+    //Continues after writeHeader at byte offset size of a file that already holds nsnapshots snapshots
+    virtual void resume(uint64_t size, uint64_t nsnapshots) = 0;
+};
+
+//The open mode of the stream based writers: the existing file is kept when resuming
+inline std::ios::openmode outputMode(bool resume){
+    return std::ios::binary | std::ios::out | (resume ? std::ios::in : std::ios::trunc);
+}
+
+//The original text format: parameters as comment lines, then one "x rho" line per point for each snapshot
+class TextSnapshotWriter : public SnapshotWriter {
+  public:
+    explicit TextSnapshotWriter(const std::string &filename, bool resume = false);
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+    void writeSnapshot(size_t step, const Field &rho) override;
+    void close() override;
+    uint64_t flush() override;
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+  private:
+    std::ofstream fout;
+    Parameters param;
+    std::optional<UniformGrid> x;   // set by writeHeader
+};
+
+//Same layout as TextSnapshotWriter, but each snapshot is formatted with std::to_chars into one preallocated
+//buffer and written with a single call. The "x " column is formatted once in writeHeader.
+//precision is the number of significant digits (6 reproduces the stream output byte for byte), or
+//shortestPrecision for the shortest text that reads back to the same double.
+class FastTextSnapshotWriter : public SnapshotWriter {
+  public:
+    FastTextSnapshotWriter(const std::string &filename, int precision, bool resume = false);
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+    void writeSnapshot(size_t step, const Field &rho) override;
+    void close() override;
+    uint64_t flush() override;
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+  private:
+    // Appends the formatted value at position 'end' of the buffer and returns the new end
+    char* format(char* end, double value) const;
+
+    std::ofstream fout;
+    int precision;
+    double dt = 0.0;
+    std::vector<char> xtext;        // "x " for every grid point, back to back
+    std::vector<uint8_t> xlength;   // length of each point's text in xtext (at most 33 bytes)
+    std::vector<char> buffer;       // holds one complete snapshot
+};
+
+const int shortestPrecision = -1;
+//Most significant digits of the text format; 17 already reproduce every double
+const int maxTextPrecision = 17;
+
+//Layout of the binary format, all values little-endian:
+//  BinaryHeader
+//  x                  ngrid float64 values, written once
+//  per snapshot:      BinarySnapshotHeader followed by ngrid values of elementSize bytes (float64 or float32)
+//Every snapshot record has the same size, so snapshot n starts at
+//  sizeof(BinaryHeader) + 8*ngrid + n*(sizeof(BinarySnapshotHeader) + elementSize*ngrid)
+//Compressed files (codec != 0, elementSize 0) instead store after each BinarySnapshotHeader one
+//uint64 byte count and the encoded values for every block of blockPoints values.
+struct BinaryHeader {
+    char     magic[8];          // "WAVE1D" followed by two zero bytes
+    uint32_t version;           // version of this layout
+    uint32_t elementSize;       // 8 for float64 or 4 for float32 snapshot values
+    double   c;                 // the parameters as written by writeParameters
+    double   tau;
+    double   x1;
+    double   x2;
+    double   runtime;
+    double   dx;
+    double   outtime;
+    char     outfilename[256];  // zero-terminated, truncated if longer
+    uint64_t ngrid;
+    double   dt;
+    uint64_t nsteps;
+    uint64_t nper;
+    uint64_t nsnapshots;        // number of complete snapshot records that follow
+    uint32_t codec;             // compression of the snapshot values, 0 for none (see snapshotCodecs.h)
+    uint32_t blockPoints;       // number of values compressed together, 0 if not compressed
+    double   tolerance;         // absolute error bound of a lossy codec, 0 otherwise
+};
+
+struct BinarySnapshotHeader {
+    uint64_t index;             // number of the snapshot, starting at 0 for the initial wave
+    uint64_t step;              // number of time steps taken
+    double   time;              // simulated time, step*dt
+};
+
+const uint32_t binaryFormatVersion = 2;
+
+//Fills in a binary header from the parameters of a run
+BinaryHeader makeBinaryHeader(const Parameters &param, uint32_t elementSize);
+
+//Returns a copy of the header with every numeric field in little-endian byte order
+BinaryHeader headerToLittleEndian(BinaryHeader header);
+
+//Size in bytes of one snapshot record, and the position of snapshot n in a binary file
+inline size_t binaryRecordSize(const BinaryHeader &header){
+    return sizeof(BinarySnapshotHeader) + header.elementSize*header.ngrid;
+}
+inline size_t binarySnapshotOffset(const BinaryHeader &header, size_t n){
+    return sizeof(BinaryHeader) + sizeof(double)*header.ngrid + n*binaryRecordSize(header);
+}
+
+//Converts a value to little-endian byte order in place (a no-op on little-endian hosts)
+template <typename T>
+inline T toLittleEndian(T value){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(T)/2; i++) {
+        std::swap(bytes[i], bytes[sizeof(T)-1-i]);
+    }
+#endif
+    return value;
+}
+
+//Writes the x values of the grid as little-endian float64, computing them a block at a time
+void writeGridLittleEndian(std::ostream &fout, const UniformGrid &x);
+
+//Binary format, see BinaryHeader for the layout
+class BinarySnapshotWriter : public SnapshotWriter {
+  public:
+    BinarySnapshotWriter(const std::string &filename, bool float32, bool resume = false);
+    void writeHeader(const Parameters &param, const UniformGrid &x) override;
+    void writeSnapshot(size_t step, const Field &rho) override;
+    void close() override;
+    uint64_t flush() override;
+    void resume(uint64_t size, uint64_t nsnapshots) override;
+
+  private:
+    std::ofstream fout;
+    bool float32;
+    BinaryHeader header;
+    std::vector<float> single;      // conversion buffer for float32 output
+    std::vector<double> swapped;    // conversion buffers on big-endian hosts
+    std::vector<float> swappedSingle;
+};
+
+//When the mapped writer asks the kernel to write modified pages back to the file
+enum class SyncPolicy { none, async, sync };
+
+//What the mapped writer tells the kernel about its access to the mapping
+enum class AdvicePolicy { normal, sequential, dontneed };
+
+//Choices for the snapshot output of a run
+struct OutputOptions {
+    std::string format = "text";    // "text", "text-stream" (iostream based), "binary", "mapped" or "compressed"
+    bool float32 = false;           // single precision values in the binary formats
+    int precision = 6;              // significant digits in the text format (1..maxTextPrecision), or shortestPrecision
+    SyncPolicy sync = SyncPolicy::none;                 // msync after each snapshot of the mapped format
+    AdvicePolicy advice = AdvicePolicy::sequential;     // madvise for the mapped format
+    std::string codec = "lossless"; // compression of the "compressed" format: "lossless" or "lossy"
+    double tolerance = 0.0;         // absolute error bound of the lossy codec
+    size_t compressionBlock = defaultCompressionBlock;  // values per independently compressed block
+    int compressionThreads = 0;     // threads compressing the blocks, 0 for the OpenMP default
+    bool resume = false;            // continue the existing file of a restarted run
+};
+
+//Converts the names "none", "async", "sync" and "normal", "sequential", "dontneed" to policies
+bool parseSyncPolicy(const std::string &name, SyncPolicy &policy);
+bool parseAdvicePolicy(const std::string &name, AdvicePolicy &policy);
+
+//Creates the writer for the chosen format, or returns nullptr for an unknown format or codec, or a
+//text precision out of range
+std::unique_ptr<SnapshotWriter> makeSnapshotWriter(const OutputOptions &options, const std::string &filename);
+
+#endif
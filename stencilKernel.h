@@ -0,0 +1,66 @@
+#ifndef STENCILKERNEL_H
+#define STENCILKERNEL_H
+
+#include <cstddef>
+#include "wave1d.h"
+
+//Holds the coefficients of the leap-frog update folded into a three point stencil
+//    rho_next[i] = a*rho[i] + b*rho_prev[i] + k*(rho[i-1] + rho[i+1])
+//or, for the higher orders of param.order, into the wider stencil
+//    rho_next[i] = w[0]*rho[i] + b*rho_prev[i] + sum_{j=1..order/2} w[j]*(rho[i-j] + rho[i+j])
+//with w = weights[order/2-1] (see stencilWide). Build it once after deriveParameters, the stencil itself
+//then needs no divisions or pow calls.
+class StencilKernel {
+  public:
+    double  a;              // weight of the current value
+    double  b;              // weight of the previous value
+    double  k;              // weight of the neighbours, the squared Courant number (c*dt/dx)^2
+    size_t  ngrid;          // number of x points
+    size_t  order;          // spatial order of accuracy, 2, 4 or 6
+    double  weights[3][4];  // w of the orders 2, 4 and 6 at the distances 0..3; weights[0] is {a, k, 0, 0}
+
+    explicit StencilKernel(const Parameters &param);
+
+    //Whether the friction term contributes, if not the stencil reduces to b = -1
+    bool damped() const;
+};
+
+//Grid size for which timeStep uses the fixed-size instance of applyStencil
+const size_t fixedStencilSize = 4096;
+
+//Evolves the inner region of the grid over one time step with the given kernel.
+//Damped=false drops the friction term at compile time, a non-zero N fixes the grid size at compile time
+//(and must then equal kernel.ngrid). Boundary values are not touched.
+template <bool Damped = true, size_t N = 0>
+inline void applyStencil(const StencilKernel &kernel, const double *__restrict rho, const double *__restrict rho_prev,
+                         double *__restrict rho_next){
+    const size_t ngrid = (N != 0) ? N : kernel.ngrid;
+    const double a = kernel.a;
+    const double b = kernel.b;
+    const double k = kernel.k;
+    for (size_t i = 1; i <= ngrid-2; i++) {
+        if (Damped) {
+            rho_next[i] = a*rho[i] + b*rho_prev[i] + k*(rho[i-1] + rho[i+1]);
+        } else {
+            rho_next[i] = a*rho[i] - rho_prev[i] + k*(rho[i-1] + rho[i+1]);
+        }
+    }
+}
+
+//Evolves the points begin..end-1 over one time step for any scalar type: the values are stored as Real and
+//the update is computed in Accum, e.g. float storage with double accumulation. The coefficients are
+//rounded to Accum once.
+template <typename Real, typename Accum = Real>
+inline void applyStencilAs(const StencilKernel &kernel, const Real *rho, const Real *rho_prev, Real *rho_next,
+                           size_t begin, size_t end){
+    const Accum a = static_cast<Accum>(kernel.a);
+    const Accum b = static_cast<Accum>(kernel.b);
+    const Accum k = static_cast<Accum>(kernel.k);
+    #pragma omp simd
+    for (size_t i = begin; i < end; i++) {
+        rho_next[i] = static_cast<Real>(a*static_cast<Accum>(rho[i]) + b*static_cast<Accum>(rho_prev[i])
+                                        + k*(static_cast<Accum>(rho[i-1]) + static_cast<Accum>(rho[i+1])));
+    }
+}
+
+#endif
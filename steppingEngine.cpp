@@ -0,0 +1,364 @@
+//steppingEngine.cpp
+//
+//The built-in stepping engines and the registry they are found in
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <omp.h>
+#include "steppingEngine.h"
+#include "threadedStepping.h"
+#include "simdKernels.h"
+
+void SteppingEngine::evolve(size_t first, size_t last, size_t nper, const SnapshotCallback &snapshot){
+    const bool batch = capabilities().multiStep;
+    size_t s = first;
+    while (s < last and failure.empty()) {
+        // Never step past the next snapshot or the end of the run
+        size_t k = batch ? std::min(nper - s%nper, last - s) : 1;
+        step(k);
+        if (not failure.empty()) {
+            return;
+        }
+        s += k;
+        if (s%nper == 0) {
+            snapshot(s, fetchSnapshot(), fetchPrevious());
+        }
+    }
+}
+
+size_t SteppingEngine::evolveToSnapshot(size_t first, size_t last, size_t nper, const SnapshotCallback &snapshot){
+    size_t aligned = std::min(last, first + (nper - first%nper)%nper);
+    SteppingEngine::evolve(first, aligned, nper, snapshot);
+    return aligned;
+}
+
+namespace {
+
+// used where an engine steps without output
+const std::function<void(size_t)> noSnapshot = [](size_t) {};
+
+//Keeps the time levels on the host
+class HostEngine : public SteppingEngine {
+  public:
+    void init(const StencilKernel &kernel, Field rho, Field rho_prev, size_t step) override {
+        kernel_.emplace(kernel);
+        completed.store(step);
+        rho_ = std::move(rho);
+        rho_prev_ = std::move(rho_prev);
+        rho_next_.assign(kernel.ngrid, 0.0);
+        rho_[0] = rho_[kernel.ngrid-1] = 0.0;
+        rho_prev_[0] = rho_prev_[kernel.ngrid-1] = 0.0;
+    }
+    const Field &fetchSnapshot() override {
+        return rho_;
+    }
+    const Field &fetchPrevious() override {
+        return rho_prev_;
+    }
+    void fetchState(Field &rho, Field &rho_prev) override {
+        std::copy(rho_.begin(), rho_.end(), rho.begin());
+        std::copy(rho_prev_.begin(), rho_prev_.end(), rho_prev.begin());
+    }
+  protected:
+    // adapts snapshot to the engines that only pass the number of steps since they were started at step first
+    std::function<void(size_t)> forward(const SnapshotCallback &snapshot, size_t first) {
+        return [this, &snapshot, first](size_t s) { snapshot(first + s, rho_, rho_prev_); };
+    }
+    std::optional<StencilKernel> kernel_;  // set by init
+    Field rho_;
+    Field rho_prev_;
+    Field rho_next_;
+};
+
+//One step at a time on the calling thread, with the stencil chosen by selectSimdLevel
+class SerialEngine : public HostEngine {
+  public:
+    EngineCapabilities capabilities() const override {
+        return {false, false, false, true};
+    }
+    void step(size_t k) override {
+        for (size_t s = 0; s < k; s++) {
+            timeStep(rho_, rho_prev_, rho_next_, *kernel_);
+            rotateBuffers(rho_prev_, rho_, rho_next_);
+            completed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+//Chunks of the interior on a team of OpenMP threads, see threadedStepping.h. The time levels live in a
+//FieldArena placed by the same threads; the Fields of HostEngine only stage the snapshots.
+class ThreadedEngine : public HostEngine {
+  public:
+    explicit ThreadedEngine(const EngineOptions &options) : nthreads_(std::max(options.nthreads, 0)) {}
+    EngineCapabilities capabilities() const override {
+        return {true, false, true, true};
+    }
+    void init(const StencilKernel &kernel, Field rho, Field rho_prev, size_t step) override {
+        HostEngine::init(kernel, std::move(rho), std::move(rho_prev), step);
+        rho_next_ = Field();
+        arena_ = std::make_unique<FieldArena>(kernel.ngrid, 3, nthreads_);
+        current_ = arena_->level(0);
+        previous_ = arena_->level(1);
+        next_ = arena_->level(2);
+        std::copy(rho_.begin(), rho_.end(), current_.begin());
+        std::copy(rho_prev_.begin(), rho_prev_.end(), previous_.begin());
+    }
+    void step(size_t k) override {
+        evolveThreaded(current_, previous_, next_, *kernel_, k, k, nthreads_, noSnapshot, &completed);
+    }
+    void evolve(size_t first, size_t last, size_t nper, const SnapshotCallback &snapshot) override {
+        // One thread team for the whole run
+        size_t s = evolveToSnapshot(first, last, nper, snapshot);
+        auto staged = [this, &snapshot, s](size_t steps) {
+            stage();
+            snapshot(s + steps, rho_, rho_prev_);
+        };
+        evolveThreaded(current_, previous_, next_, *kernel_, last - s, nper, nthreads_, staged, &completed);
+    }
+    const Field &fetchSnapshot() override {
+        stage();
+        return rho_;
+    }
+    const Field &fetchPrevious() override {
+        stage();
+        return rho_prev_;
+    }
+    void fetchState(Field &rho, Field &rho_prev) override {
+        std::copy(current_.begin(), current_.end(), rho.begin());
+        std::copy(previous_.begin(), previous_.end(), rho_prev.begin());
+    }
+  private:
+    // copies the two latest levels out of the arena
+    void stage() {
+        std::copy(current_.begin(), current_.end(), rho_.begin());
+        std::copy(previous_.begin(), previous_.end(), rho_prev_.begin());
+    }
+    int nthreads_;
+    std::unique_ptr<FieldArena> arena_;
+    FieldSpan current_;
+    FieldSpan previous_;
+    FieldSpan next_;
+};
+
+//Temporal blocking with overlapped tiles, see temporalBlocking.h
+class TiledEngine : public HostEngine {
+  public:
+    explicit TiledEngine(const EngineOptions &options) : options_(options) {
+        if (options_.nthreads < 0) {
+            // A single thread already gains from the cache reuse
+            options_.nthreads = 1;
+        }
+    }
+    EngineCapabilities capabilities() const override {
+        return {true, false, true, false};
+    }
+    void step(size_t k) override {
+        evolveTiled(rho_, rho_prev_, rho_next_, *kernel_, k, k, options_.tilePoints, options_.tileSteps,
+                    options_.nthreads, noSnapshot, &completed);
+    }
+  private:
+    EngineOptions options_;
+};
+
+//Device-resident stepping, see gpuStepping.h
+class GpuEngine : public HostEngine {
+  public:
+    explicit GpuEngine(const EngineOptions &options) : gpuSteps_(options.gpuSteps) {}
+    EngineCapabilities capabilities() const override {
+        return {true, true, false, false};
+    }
+    void step(size_t k) override {
+        if (failure.empty()) {
+            evolveGpu(rho_, rho_prev_, *kernel_, k, k, gpuSteps_, noSnapshot, failure, &completed);
+        }
+    }
+    void evolve(size_t first, size_t last, size_t nper, const SnapshotCallback &snapshot) override {
+        // Keep the state on the device for the whole run, copying back only the snapshots
+        size_t s = evolveToSnapshot(first, last, nper, snapshot);
+        if (failure.empty()) {
+            evolveGpu(rho_, rho_prev_, *kernel_, last - s, nper, gpuSteps_, forward(snapshot, s), failure, &completed);
+        }
+    }
+  private:
+    size_t gpuSteps_;
+};
+
+//Keeps the time levels as Real and computes each update in Accum, converting to double only for the output
+template <typename Real, typename Accum>
+class ReducedPrecisionEngine : public SteppingEngine {
+  public:
+    explicit ReducedPrecisionEngine(const EngineOptions &options) : nthreads_(options.nthreads) {}
+    EngineCapabilities capabilities() const override {
+        // Batching saves the conversion of the skipped snapshots
+        return {true, false, nthreads_ >= 0, false};
+    }
+    void init(const StencilKernel &kernel, Field rho, Field rho_prev, size_t step) override {
+        kernel_.emplace(kernel);
+        completed.store(step);
+        auto round = [](double value) { return static_cast<Real>(value); };
+        rho_.resize(kernel.ngrid);
+        rho_prev_.resize(kernel.ngrid);
+        std::transform(rho.begin(), rho.end(), rho_.begin(), round);
+        std::transform(rho_prev.begin(), rho_prev.end(), rho_prev_.begin(), round);
+        rho_next_.assign(kernel.ngrid, Real(0));
+        rho_[0] = rho_[kernel.ngrid-1] = Real(0);
+        rho_prev_[0] = rho_prev_[kernel.ngrid-1] = Real(0);
+        wave_.assign(kernel.ngrid, 0.0);
+        previous_.assign(kernel.ngrid, 0.0);
+    }
+    void step(size_t k) override {
+        const size_t ngrid = kernel_->ngrid;
+        if (nthreads_ < 0) {
+            for (size_t s = 0; s < k; s++) {
+                stencil(rho_.data(), rho_prev_.data(), rho_next_.data(), 1, ngrid-1);
+                rotateBuffers(rho_prev_, rho_, rho_next_);
+                completed.fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        // Same decomposition as evolveThreaded, one team for the k steps
+        const long nchunks = static_cast<long>((ngrid - 2 + threadChunkPoints - 1)/threadChunkPoints);
+        #pragma omp parallel num_threads(nthreads_ > 0 ? nthreads_ : omp_get_max_threads())
+        for (size_t s = 0; s < k; s++) {
+            #pragma omp for schedule(static)
+            for (long chunk = 0; chunk < nchunks; chunk++) {
+                size_t begin = 1 + static_cast<size_t>(chunk)*threadChunkPoints;
+                size_t end = std::min(begin + threadChunkPoints, ngrid - 1);
+                stencil(rho_.data(), rho_prev_.data(), rho_next_.data(), begin, end);
+            }
+            #pragma omp single
+            {
+                rotateBuffers(rho_prev_, rho_, rho_next_);
+                completed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    const Field &fetchSnapshot() override {
+        std::copy(rho_.begin(), rho_.end(), wave_.begin());
+        return wave_;
+    }
+    const Field &fetchPrevious() override {
+        std::copy(rho_prev_.begin(), rho_prev_.end(), previous_.begin());
+        return previous_;
+    }
+    void fetchState(Field &rho, Field &rho_prev) override {
+        std::copy(rho_.begin(), rho_.end(), rho.begin());
+        std::copy(rho_prev_.begin(), rho_prev_.end(), rho_prev.begin());
+    }
+  private:
+    using Levels = std::vector<Real, AlignedAllocator<Real>>;
+
+    // the vectorized float stencils of simdKernels.h, the generic template for other types
+    void stencil(const Real *rho, const Real *rho_prev, Real *rho_next, size_t begin, size_t end) const {
+        if constexpr (std::is_same_v<Real, float> and std::is_same_v<Accum, float>) {
+            stencilFloat(*kernel_, rho, rho_prev, rho_next, begin, end);
+        } else if constexpr (std::is_same_v<Real, float> and std::is_same_v<Accum, double>) {
+            stencilMixed(*kernel_, rho, rho_prev, rho_next, begin, end);
+        } else {
+            applyStencilAs<Real, Accum>(*kernel_, rho, rho_prev, rho_next, begin, end);
+        }
+    }
+
+    static void rotateBuffers(Levels &rho_prev, Levels &rho, Levels &rho_next) {
+        std::swap(rho_prev, rho);
+        std::swap(rho, rho_next);
+    }
+
+    int nthreads_;
+    std::optional<StencilKernel> kernel_;  // set by init
+    Levels rho_;
+    Levels rho_prev_;
+    Levels rho_next_;
+    Field wave_;                           // the levels converted for the output
+    Field previous_;
+};
+
+// the reduced precision engines in place of the double ones, nullptr where there is none
+std::unique_ptr<SteppingEngine> makeReducedPrecisionEngine(const EngineOptions &options){
+    if (options.precision == Precision::float32) {
+        return std::make_unique<ReducedPrecisionEngine<float, float>>(options);
+    } else if (options.precision == Precision::mixed) {
+        return std::make_unique<ReducedPrecisionEngine<float, double>>(options);
+    }
+    return nullptr;
+}
+
+std::map<std::string, EngineFactory> &registry(){
+    static std::map<std::string, EngineFactory> engines = {
+        {"serial", [](const EngineOptions &options) -> std::unique_ptr<SteppingEngine> {
+            if (options.precision != Precision::float64) {
+                EngineOptions serial = options;
+                serial.nthreads = -1;
+                return makeReducedPrecisionEngine(serial);
+            }
+            return std::make_unique<SerialEngine>();
+        }},
+        {"threaded", [](const EngineOptions &options) -> std::unique_ptr<SteppingEngine> {
+            if (options.precision != Precision::float64) {
+                EngineOptions threaded = options;
+                threaded.nthreads = std::max(options.nthreads, 0);
+                return makeReducedPrecisionEngine(threaded);
+            }
+            return std::make_unique<ThreadedEngine>(options);
+        }},
+        {"tiled", [](const EngineOptions &options) -> std::unique_ptr<SteppingEngine> {
+            if (options.precision != Precision::float64) {
+                return nullptr;
+            }
+            return std::make_unique<TiledEngine>(options);
+        }},
+        {"gpu", [](const EngineOptions &options) -> std::unique_ptr<SteppingEngine> {
+            if (not gpuAvailable() or options.precision != Precision::float64) {
+                return nullptr;
+            }
+            return std::make_unique<GpuEngine>(options);
+        }},
+    };
+    return engines;
+}
+
+}
+
+const char* precisionName(Precision precision){
+    switch (precision) {
+        case Precision::float64: return "float64";
+        case Precision::float32: return "float32";
+        case Precision::mixed:   return "mixed";
+    }
+    return "unknown";
+}
+
+bool parsePrecision(const std::string &name, Precision &precision){
+    if (name == "float64") {
+        precision = Precision::float64;
+    } else if (name == "float32") {
+        precision = Precision::float32;
+    } else if (name == "mixed") {
+        precision = Precision::mixed;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void registerEngine(const std::string &name, EngineFactory factory){
+    registry()[name] = std::move(factory);
+}
+
+std::unique_ptr<SteppingEngine> makeEngine(const std::string &name, const EngineOptions &options){
+    auto found = registry().find(name);
+    if (found == registry().end()) {
+        return nullptr;
+    }
+    return found->second(options);
+}
+
+std::vector<std::string> engineNames(){
+    std::vector<std::string> names;
+    for (const auto &entry : registry()) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
@@ -0,0 +1,92 @@
+#ifndef STEPPINGENGINE_H
+#define STEPPINGENGINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wave1d.h"
+#include "stencilKernel.h"
+#include "temporalBlocking.h"
+#include "gpuStepping.h"
+
+//What the driver may assume about an engine
+struct EngineCapabilities {
+    bool multiStep;         // step(k) is cheaper than k calls of step(1), so steps are batched up to a snapshot
+    bool deviceResident;    // the state lives off the host and fetchSnapshot copies it back
+    bool threaded;          // steps with a team of threads
+    bool wideStencils;      // steps the stencils of order 4 and 6, which reach beyond the nearest neighbours
+};
+
+//Scalar type of the time levels: double throughout, float throughout, or float storage with the
+//update computed in double
+enum class Precision { float64, float32, mixed };
+
+//Converts between precisions and their names ("float64", "float32", "mixed")
+const char* precisionName(Precision precision);
+bool parsePrecision(const std::string &name, Precision &precision);
+
+//Settings read by the engines when they are created
+struct EngineOptions {
+    int    nthreads = -1;                         // 0 leaves the count to OpenMP, -1 is the engine's default
+    size_t tilePoints = defaultTilePoints;
+    size_t tileSteps = defaultTileSteps;
+    size_t gpuSteps = defaultGpuStepsPerLaunch;   // steps per kernel launch
+    Precision precision = Precision::float64;     // only the serial and threaded engines step in less than float64
+};
+
+// called with the step number, the wave at that step and the wave one step earlier
+using SnapshotCallback = std::function<void(size_t step, const Field &rho, const Field &rho_prev)>;
+
+//Common interface of the ways to advance the wave in time
+class SteppingEngine {
+  public:
+    virtual ~SteppingEngine() = default;
+    virtual EngineCapabilities capabilities() const = 0;
+    //Takes over the two initial time levels at the given step (0, or a restart), setting the boundaries to zero
+    virtual void init(const StencilKernel &kernel, Field rho, Field rho_prev, size_t step) = 0;
+    //Advances the wave by k steps
+    virtual void step(size_t k) = 0;
+    //Gives the wave at the current step, valid until the next call of step
+    virtual const Field &fetchSnapshot() = 0;
+    //Gives the wave one step earlier, for quantities that need the time derivative
+    virtual const Field &fetchPrevious() = 0;
+    //Copies the current and the previous time level, e.g. for a checkpoint; both must hold ngrid values
+    virtual void fetchState(Field &rho, Field &rho_prev) = 0;
+    //Advances the wave from step first to step last and calls snapshot at every step s in between
+    //(last included) with s%nper == 0. By default this steps in batches as allowed by the capabilities
+    //and fetches each snapshot; engines that overlap stepping with the output override it.
+    virtual void evolve(size_t first, size_t last, size_t nper, const SnapshotCallback &snapshot);
+    //The current step, kept up to date during evolve so that another thread can follow the run
+    const std::atomic<size_t> &progress() const {
+        return completed;
+    }
+    //Why the engine stopped stepping, e.g. a failed GPU runtime call; empty while it works. After a
+    //failure step and evolve return without stepping and the state is that of an unknown earlier step.
+    const std::string &error() const {
+        return failure;
+    }
+  protected:
+    //Runs the default evolve up to the first snapshot step after first (or last), where the engines that
+    //only count steps from zero can take over; gives that step
+    size_t evolveToSnapshot(size_t first, size_t last, size_t nper, const SnapshotCallback &snapshot);
+
+    std::atomic<size_t> completed{0};
+    std::string failure;
+};
+
+// creates an engine, or gives nullptr if it cannot run on this machine
+using EngineFactory = std::function<std::unique_ptr<SteppingEngine>(const EngineOptions &options)>;
+
+//Makes an engine available under the given name, next to the built-in serial, threaded, tiled and gpu
+void registerEngine(const std::string &name, EngineFactory factory);
+
+//Creates the engine registered under the given name, nullptr if it is unknown or cannot run
+std::unique_ptr<SteppingEngine> makeEngine(const std::string &name, const EngineOptions &options);
+
+//Names of the registered engines in alphabetical order
+std::vector<std::string> engineNames();
+
+#endif
@@ -0,0 +1,101 @@
+//temporalBlocking.cpp
+//
+//Temporally blocked time stepping: several leap-frog steps per tile while the tile is in cache
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+#include "temporalBlocking.h"
+#include "simdKernels.h"
+
+//Private time levels of one thread, sized for a tile and its overlap on both sides
+struct TileBuffers {
+    Field current;
+    Field previous;
+    Field next;
+};
+
+//Advances the tile [lo,hi) from (rho, rho_prev) at time level t to t+k, storing
+//level t+k in out_rho and level t+k-1 in out_prev
+static void advanceTile(const StencilKernel &kernel, const Field &rho, const Field &rho_prev,
+                        Field &out_rho, Field &out_prev, size_t lo, size_t hi, size_t k, TileBuffers &tile,
+                        StencilFunction stencil){
+    const size_t ngrid = kernel.ngrid;
+    const size_t wlo = (lo > k) ? lo - k : 0;
+    const size_t whi = std::min(ngrid, hi + k);
+    const size_t width = whi - wlo;
+
+    std::copy(rho.begin() + static_cast<long>(wlo), rho.begin() + static_cast<long>(whi), tile.current.begin());
+    std::copy(rho_prev.begin() + static_cast<long>(wlo), rho_prev.begin() + static_cast<long>(whi), tile.previous.begin());
+    double *current = tile.current.data();
+    double *previous = tile.previous.data();
+    double *next = tile.next.data();
+    // The global Dirichlet points inside the window stay zero on every level
+    next[0] = current[0];
+    next[width-1] = current[width-1];
+
+    // Each step the valid region shrinks by one point on sides that are not a global boundary
+    for (size_t j = 1; j <= k; j++) {
+        size_t begin = (wlo == 0) ? 1 : j;
+        size_t end = (whi == ngrid) ? width - 1 : width - j;
+        stencil(kernel, current, previous, next, begin, end);
+        double *oldest = previous;
+        previous = current;
+        current = next;
+        next = oldest;
+    }
+
+    std::copy(current + (lo - wlo), current + (hi - wlo), out_rho.begin() + static_cast<long>(lo));
+    std::copy(previous + (lo - wlo), previous + (hi - wlo), out_prev.begin() + static_cast<long>(lo));
+}
+
+void evolveTiled(Field &rho, Field &rho_prev, Field &rho_next, const StencilKernel &kernel,
+                 size_t nsteps, size_t nper, size_t tilePoints, size_t tileSteps, int nthreads,
+                 const std::function<void(size_t)> &snapshot, std::atomic<size_t> *progress){
+    const size_t ngrid = kernel.ngrid;
+    const long ntiles = static_cast<long>((ngrid + tilePoints - 1)/tilePoints);
+    const StencilFunction stencil = stencilFunction(selectedSimdLevel());
+    if (nthreads <= 0) {
+        nthreads = omp_get_max_threads();
+    }
+
+    // Set zero Dirichlet boundary conditions, the stencil never writes them so they carry over
+    rho[0] = rho[ngrid-1] = 0.0;
+    rho_prev[0] = rho_prev[ngrid-1] = 0.0;
+
+    // Tiles read the old levels while others write the new ones, so a fourth level is needed;
+    // rho_next serves as the new rho and out_prev as the new rho_prev. Everything is allocated up front.
+    Field out_prev(ngrid, 0);
+    std::vector<TileBuffers> tiles(static_cast<size_t>(nthreads));
+    for (TileBuffers &tile : tiles) {
+        size_t width = std::min(ngrid, tilePoints + 2*tileSteps);
+        tile.current.assign(width, 0);
+        tile.previous.assign(width, 0);
+        tile.next.assign(width, 0);
+    }
+
+    size_t s = 0;
+    while (s < nsteps) {
+        // Never step past the next snapshot or the end of the run
+        size_t untilSnapshot = nper - s%nper;
+        size_t k = std::min({tileSteps, untilSnapshot, nsteps - s});
+
+        #pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (long t = 0; t < ntiles; t++) {
+            size_t lo = static_cast<size_t>(t)*tilePoints;
+            size_t hi = std::min(ngrid, lo + tilePoints);
+            advanceTile(kernel, rho, rho_prev, rho_next, out_prev, lo, hi, k,
+                        tiles[static_cast<size_t>(omp_get_thread_num())], stencil);
+        }
+
+        // The new levels become current, the old ones are recycled as output buffers
+        std::swap(rho, rho_next);
+        std::swap(rho_prev, out_prev);
+        s += k;
+        if (progress) {
+            progress->fetch_add(k, std::memory_order_relaxed);
+        }
+        if (s%nper == 0) {
+            snapshot(s);
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef TEMPORALBLOCKING_H
+#define TEMPORALBLOCKING_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include "wave1d.h"
+#include "stencilKernel.h"
+
+//Default number of points per tile; three tile-sized time levels stay within a 256 kB L2 cache
+const size_t defaultTilePoints = 8192;
+
+//Default number of steps a tile is advanced before moving on to the next tile
+const size_t defaultTileSteps = 32;
+
+//Evolves the wave over nsteps time steps with temporal blocking: the grid is cut into tiles of tilePoints,
+//and each tile is advanced by up to tileSteps steps in a private buffer before the next tile is visited.
+//A tile reads tileSteps extra points on either side (an overlapped trapezoid), so tiles are independent
+//and are processed by nthreads OpenMP threads (nthreads = 0 uses the OpenMP default).
+//Blocks never cross a snapshot: after every step s with (s+1)%nper == 0, snapshot(s+1) is called with rho
+//holding the wave at that step. A given progress counter is advanced after every block of steps.
+//Results are identical to repeated calls of timeStep.
+void evolveTiled(Field &rho, Field &rho_prev, Field &rho_next, const StencilKernel &kernel,
+                 size_t nsteps, size_t nper, size_t tilePoints, size_t tileSteps, int nthreads,
+                 const std::function<void(size_t)> &snapshot, std::atomic<size_t> *progress = nullptr);
+
+#endif
@@ -0,0 +1,69 @@
+//threadedStepping.cpp
+//
+//Multithreaded time stepping with OpenMP, using a static decomposition of the interior of the grid
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <omp.h>
+#include "threadedStepping.h"
+#include "simdKernels.h"
+
+// the stepping for both kinds of time levels, Field and FieldSpan
+template <typename Level>
+static void evolveLevels(Level &rho, Level &rho_prev, Level &rho_next, const StencilKernel &kernel,
+                         size_t nsteps, size_t nper, int nthreads, const std::function<void(size_t)> &snapshot,
+                         std::atomic<size_t> *progress){
+    const size_t ngrid = kernel.ngrid;
+    const size_t interior = ngrid - 2;
+    const long nchunks = static_cast<long>((interior + threadChunkPoints - 1)/threadChunkPoints);
+    if (nthreads <= 0) {
+        nthreads = omp_get_max_threads();
+    }
+
+    // Set zero Dirichlet boundary conditions, the stencil never writes them so they carry over
+    rho[0] = rho[ngrid-1] = 0.0;
+    rho_next[0] = rho_next[ngrid-1] = 0.0;
+    rho_prev[0] = rho_prev[ngrid-1] = 0.0;
+
+    // One team for all steps; the implicit barriers of 'for' and 'single' order the steps
+    #pragma omp parallel num_threads(nthreads)
+    for (size_t s = 0; s < nsteps; s++) {
+        #pragma omp for schedule(static)
+        for (long chunk = 0; chunk < nchunks; chunk++) {
+            size_t begin = 1 + static_cast<size_t>(chunk)*threadChunkPoints;
+            size_t end = (begin + threadChunkPoints < ngrid - 1) ? begin + threadChunkPoints : ngrid - 1;
+            applyStencilRange(kernel, rho.data(), rho_prev.data(), rho_next.data(), begin, end);
+        }
+        #pragma omp single
+        {
+            std::swap(rho_prev, rho);
+            std::swap(rho, rho_next);
+            if (progress) {
+                progress->fetch_add(1, std::memory_order_relaxed);
+            }
+            if ((s+1)%nper == 0) {
+                snapshot(s+1);
+            }
+        }
+    }
+}
+
+void evolveThreaded(Field &rho, Field &rho_prev, Field &rho_next, const StencilKernel &kernel,
+                    size_t nsteps, size_t nper, int nthreads, const std::function<void(size_t)> &snapshot,
+                    std::atomic<size_t> *progress){
+    evolveLevels(rho, rho_prev, rho_next, kernel, nsteps, nper, nthreads, snapshot, progress);
+}
+
+void evolveThreaded(FieldSpan &rho, FieldSpan &rho_prev, FieldSpan &rho_next, const StencilKernel &kernel,
+                    size_t nsteps, size_t nper, int nthreads, const std::function<void(size_t)> &snapshot,
+                    std::atomic<size_t> *progress){
+    evolveLevels(rho, rho_prev, rho_next, kernel, nsteps, nper, nthreads, snapshot, progress);
+}
+
+int threadsFromEnvironment(){
+    const char* value = std::getenv("WAVE1D_THREADS");
+    if (value == nullptr or *value == '\0') {
+        return -1;
+    }
+    return std::atoi(value);
+}
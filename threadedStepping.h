@@ -0,0 +1,54 @@
+#ifndef THREADEDSTEPPING_H
+#define THREADEDSTEPPING_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <omp.h>
+#include "wave1d.h"
+#include "stencilKernel.h"
+#include "fieldArena.h"
+
+//Number of grid points per chunk of the interior handed to a thread, such that the three time levels of one
+//chunk (24 bytes per point) fit comfortably in a 256 kB L2 cache
+const size_t threadChunkPoints = 8192;
+
+//Calls fill(begin, end) on a team of nthreads threads (0 for the OpenMP default) for the ranges of the
+//points 0..ngrid-1 that evolveThreaded steps on each thread, the first and the last also covering the
+//boundary points. Writing new memory this way places each page on the NUMA node that steps it.
+template <typename Fill>
+void forEachThreadChunk(size_t ngrid, int nthreads, const Fill &fill){
+    const size_t interior = (ngrid > 2) ? ngrid - 2 : 0;
+    const long nchunks = static_cast<long>((interior + threadChunkPoints - 1)/threadChunkPoints);
+    if (nchunks <= 1) {
+        // A single chunk goes to the first thread anyway, without starting a team
+        fill(size_t(0), ngrid);
+        return;
+    }
+    #pragma omp parallel for schedule(static) num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+    for (long chunk = 0; chunk < nchunks; chunk++) {
+        size_t begin = (chunk == 0) ? 0 : 1 + static_cast<size_t>(chunk)*threadChunkPoints;
+        size_t end = (chunk + 1 == nchunks) ? ngrid : 1 + static_cast<size_t>(chunk + 1)*threadChunkPoints;
+        fill(begin, end);
+    }
+}
+
+//Evolves the wave over nsteps time steps on one persistent team of nthreads OpenMP threads
+//(nthreads = 0 uses the OpenMP default, e.g. from OMP_NUM_THREADS).
+//The interior 1..ngrid-2 is split into static chunks of threadChunkPoints. After every step s with
+//(s+1)%nper == 0, snapshot(s+1) is called by a single thread while the others wait, with rho holding
+//the wave at that step. A given progress counter is incremented after every step.
+//Results are identical to repeated calls of timeStep.
+void evolveThreaded(Field &rho, Field &rho_prev, Field &rho_next, const StencilKernel &kernel,
+                    size_t nsteps, size_t nper, int nthreads, const std::function<void(size_t)> &snapshot,
+                    std::atomic<size_t> *progress = nullptr);
+
+//Same on time levels in a FieldArena, which should be created with the same nthreads
+void evolveThreaded(FieldSpan &rho, FieldSpan &rho_prev, FieldSpan &rho_next, const StencilKernel &kernel,
+                    size_t nsteps, size_t nper, int nthreads, const std::function<void(size_t)> &snapshot,
+                    std::atomic<size_t> *progress = nullptr);
+
+//Reads the number of threads from the WAVE1D_THREADS environment variable, returns -1 if it is not set
+int threadsFromEnvironment();
+
+#endif
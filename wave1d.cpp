@@ -3,65 +3,586 @@
 // Ramses van Zon - 2015-2023
 //
 
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <filesystem>
 #include <cmath>
 #include <vector>
 #include "wave1d.h"
+#include "stencilKernel.h"
+#include "simdKernels.h"
+#include "threadedStepping.h"
+#include "temporalBlocking.h"
+#include "steppingEngine.h"
+#include "snapshotWriter.h"
+#include "asyncSnapshotWriter.h"
+#include "regionSnapshotWriter.h"
+#include "parameterSweep.h"
+#include "progressReporter.h"
+#include "checkpoint.h"
+#include "inSituAnalysis.h"
+#include "accuracyReport.h"
+#include "initialCondition.h"
+#include "simulation.h"
+#include "phaseProfiler.h"
+
+//Reads the number after the '=' of an option with std::from_chars, as the parameter files are read;
+//prints an error and gives false unless the rest of the argument is exactly one number of type T
+template <typename T>
+static bool optionValue(const std::string &arg, T &value){
+    const char* begin = arg.c_str() + arg.find('=') + 1;
+    const char* end = arg.c_str() + arg.size();
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() or result.ptr != end) {
+        std::cerr << "Error: expected a number in '" << arg << "'.\n";
+        return false;
+    }
+    return true;
+}
+
+//Shortest text that reads back as the same value, for the messages about checkpointed settings
+static std::string valueText(double value){
+    char text[32];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    return std::string(text, result.ptr);
+}
 
 int main(int argc, char* argv[])
 {
-    // Check command line argument
-    if (argc != 2) {
+    // Check command line arguments: one parameter file and optional settings
+    std::string paramfile;
+    int nthreads = threadsFromEnvironment();  // -1 means serial stepping
+    size_t tileSteps = 1;                     // 1 means no temporal blocking
+    size_t tilePoints = defaultTilePoints;
+    size_t gpuSteps = 0;                      // 0 means stepping on the CPU
+    std::string engineName;                   // empty picks the engine from the parameter file or the options
+    std::string precisionName;                // empty takes the precision from the parameter file, else float64
+    std::string referenceFile;                // results to compare the run with, empty for none
+    std::string initial;                      // empty takes the initial wave from the parameter file
+    size_t order = 0;                         // 0 takes the stencil order from the parameter file
+    double courant = 0.0;                     // 0 takes the Courant number from the parameter file
+    OutputOptions output;
+    size_t asyncBuffers = 0;                  // 0 means snapshots are written by the solver thread
+    OutputRegion region;                      // the whole grid by default
+    std::string sweepList;                    // sweep settings, see parameterSweep.h
+    std::string batchFile;
+    std::vector<double> sweepC;
+    std::vector<double> sweepTau;
+    std::string sweepOutput;
+    size_t ensembleSize = 1;
+    std::string progress;                     // where progress records go, empty for none
+    double progressInterval = defaultProgressInterval;
+    size_t checkpointEvery = 0;               // steps between checkpoints, 0 for none
+    std::string checkpointFile;               // empty means the output file name with .ckpt appended
+    std::string restartFile;
+    std::vector<Reduction> reductions;        // in-situ analysis, none by default
+    std::string seriesFile;                   // empty means the output file name with .series appended
+    size_t fieldEvery = 1;                    // full snapshots at every fieldEvery-th sample, 0 for none
+#ifdef WAVE1D_PROFILE
+    bool counters = false;
+    std::string profileFile;                  // empty prints the profile to standard error
+#endif
+    std::set<std::string> given;              // names of the options on the command line
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            given.insert(arg.substr(0, arg.find('=')));
+        }
+        if (arg.rfind("--format=", 0) == 0) {
+            // Output format: text (the default), text-stream, binary, mapped or compressed
+            output.format = arg.substr(9);
+        } else if (arg.rfind("--precision=", 0) == 0) {
+            // Significant digits of the text format, or 'shortest' for round-trip output
+            std::string digits = arg.substr(12);
+            if (digits == "shortest") {
+                output.precision = shortestPrecision;
+            } else {
+                std::from_chars_result parsed = std::from_chars(digits.data(), digits.data() + digits.size(),
+                                                                output.precision);
+                if (parsed.ec != std::errc() or parsed.ptr != digits.data() + digits.size()
+                    or output.precision < 1 or output.precision > maxTextPrecision) {
+                    std::cerr << "Error: expected --precision=1.." << maxTextPrecision << " or shortest, got '"
+                              << arg << "'.\n";
+                    return 1;
+                }
+            }
+        } else if (arg.rfind("--msync=", 0) == 0) {
+            // When the mapped format flushes snapshots to disk
+            if (not parseSyncPolicy(arg.substr(8), output.sync)) {
+                std::cerr << "Error: unknown msync policy in '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--madvise=", 0) == 0) {
+            if (not parseAdvicePolicy(arg.substr(10), output.advice)) {
+                std::cerr << "Error: unknown madvise policy in '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--codec=", 0) == 0) {
+            // Compression of the compressed format: lossless or lossy
+            output.codec = arg.substr(8);
+        } else if (arg.rfind("--tolerance=", 0) == 0) {
+            // Absolute error bound of the lossy codec
+            if (not optionValue(arg, output.tolerance)) {
+                return 1;
+            }
+        } else if (arg.rfind("--compression-block=", 0) == 0) {
+            if (not optionValue(arg, output.compressionBlock)) {
+                return 1;
+            }
+        } else if (arg.rfind("--compress-threads=", 0) == 0) {
+            if (not optionValue(arg, output.compressionThreads)) {
+                return 1;
+            }
+        } else if (arg.rfind("--sweep=", 0) == 0) {
+            // File listing one parameter file per case
+            sweepList = arg.substr(8);
+        } else if (arg.rfind("--sweep-c=", 0) == 0 or arg.rfind("--sweep-tau=", 0) == 0) {
+            // Comma-separated values of c or tau to combine with the parameter file
+            bool isC = (arg[8] == 'c');
+            if (not parseValueList(arg.substr(isC ? 10 : 12), isC ? sweepC : sweepTau)) {
+                std::cerr << "Error: malformed list of values in '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--batch=", 0) == 0) {
+            // Run every configuration of a batch file, see parameterParser.h
+            batchFile = arg.substr(8);
+        } else if (arg.rfind("--sweep-output=", 0) == 0) {
+            // One combined output file for all cases
+            sweepOutput = arg.substr(15);
+        } else if (arg.rfind("--ensemble=", 0) == 0) {
+            // Step up to this many compatible sweep cases together
+            if (not optionValue(arg, ensembleSize)) {
+                return 1;
+            }
+        } else if (arg == "--async") {
+            // Write snapshots on a background thread
+            asyncBuffers = 4;
+        } else if (arg.rfind("--async=", 0) == 0) {
+            if (not optionValue(arg, asyncBuffers)) {
+                return 1;
+            }
+        } else if (arg.rfind("--region=", 0) == 0) {
+            // Write only the points with XMIN <= x <= XMAX
+            if (not parseOutputRegion(arg.substr(9), region)) {
+                std::cerr << "Error: expected --region=XMIN:XMAX, got '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--stride=", 0) == 0) {
+            // ... and of those only every this many
+            if (not optionValue(arg, region.stride)) {
+                return 1;
+            }
+        } else if (arg == "--float32") {
+            // Store binary snapshots in single precision
+            output.float32 = true;
+        } else if (arg == "--progress") {
+            // Periodic progress records on standard error
+            progress = "stderr";
+        } else if (arg.rfind("--progress=", 0) == 0) {
+            // ... or on a Unix socket (unix:PATH) or in a metrics file
+            progress = arg.substr(11);
+        } else if (arg.rfind("--progress-interval=", 0) == 0) {
+            if (not optionValue(arg, progressInterval)) {
+                return 1;
+            }
+            if (not (progressInterval > 0.0)) {
+                std::cerr << "Error: expected a positive number of seconds in '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--reduce=", 0) == 0) {
+            // Reductions of every snapshot, e.g. energy,max,l2,mean, written as a time series
+            if (not parseReductions(arg.substr(9), reductions)) {
+                std::cerr << "Error: unknown reduction in '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--reduce-output=", 0) == 0) {
+            seriesFile = arg.substr(16);
+        } else if (arg.rfind("--field-every=", 0) == 0) {
+            // Write the full wave only at every this many snapshot times (0 for never)
+            if (not optionValue(arg, fieldEvery)) {
+                return 1;
+            }
+        } else if (arg.rfind("--checkpoint-every=", 0) == 0) {
+            // Save the full state every this many steps, independent of the snapshots
+            if (not optionValue(arg, checkpointEvery)) {
+                return 1;
+            }
+        } else if (arg.rfind("--checkpoint=", 0) == 0) {
+            checkpointFile = arg.substr(13);
+        } else if (arg.rfind("--restart=", 0) == 0) {
+            // Continue an interrupted run from its checkpoint, no parameter file needed
+            restartFile = arg.substr(10);
+        } else if (arg.rfind("--tile-steps=", 0) == 0) {
+            // Temporal blocking with this many steps per tile
+            if (not optionValue(arg, tileSteps)) {
+                return 1;
+            }
+        } else if (arg.rfind("--tile-points=", 0) == 0) {
+            if (not optionValue(arg, tilePoints)) {
+                return 1;
+            }
+        } else if (arg.rfind("--solver-precision=", 0) == 0) {
+            // float64, float32 or mixed (float32 storage, float64 arithmetic), overrides the parameter file
+            precisionName = arg.substr(19);
+        } else if (arg.rfind("--initial=", 0) == 0) {
+            // Shape of the initial wave, overrides the parameter file
+            initial = arg.substr(10);
+            InitialCondition check;
+            if (not parseInitialCondition(initial, check)) {
+                std::cerr << "Error: expected --initial=triangle, gaussian, gaussian:SIGMA or file:PATH, got '"
+                          << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--order=", 0) == 0) {
+            // Spatial order of the stencil, 2, 4 or 6, overrides the parameter file
+            if (not optionValue(arg, order)) {
+                return 1;
+            }
+            if (courantLimit(order) == 0.0) {
+                std::cerr << "Error: expected --order=2, 4 or 6, got '" << arg << "'.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--courant=", 0) == 0) {
+            // Time step as the Courant number c*dt/dx, up to the stability limit of the order
+            if (not optionValue(arg, courant)) {
+                return 1;
+            }
+        } else if (arg.rfind("--accuracy=", 0) == 0) {
+            // Report the differences to the snapshots of a float64 run in the text format
+            referenceFile = arg.substr(11);
+        } else if (arg.rfind("--engine=", 0) == 0) {
+            // Stepping engine by name, overrides the parameter file
+            engineName = arg.substr(9);
+        } else if (arg == "--gpu") {
+            // Step on the GPU, with the state resident in device memory
+            gpuSteps = defaultGpuStepsPerLaunch;
+        } else if (arg.rfind("--gpu=", 0) == 0) {
+            if (not optionValue(arg, gpuSteps)) {
+                return 1;
+            }
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            // Step with a team of threads, 0 leaves the count to OpenMP
+            if (not optionValue(arg, nthreads)) {
+                return 1;
+            }
+        } else if (arg.rfind("--simd=", 0) == 0) {
+            // Override the instruction set detected at startup
+            SimdLevel level;
+            if (not parseSimdLevel(arg.substr(7), level)) {
+                std::cerr << "Error: unknown instruction set in '" << arg << "'.\n";
+                return 1;
+            }
+            selectSimdLevel(level);
+#ifdef WAVE1D_PROFILE
+        } else if (arg == "--counters") {
+            // Hardware counters per phase
+            counters = true;
+        } else if (arg == "--profile") {
+            // Write the profile next to the output file
+            profileFile = "-";
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            profileFile = arg.substr(10);
+#endif
+        } else if (arg.rfind("--", 0) != 0 and paramfile.empty()) {
+            paramfile = arg;
+        } else {
+            std::cerr << "Error: unrecognized argument '" << arg << "'.\n";
+            return 1;
+        }
+    }
+    // The engine and precision named on the command line, with the tuning of the engines; in a sweep
+    // --threads is the number of workers, and each case without a name keeps that of its parameters
+    SimulationOptions simulation;
+    simulation.engine = engineName;
+    simulation.precision = precisionName;
+    simulation.engineOptions.tilePoints = tilePoints;
+    if (tileSteps > 1) {
+        simulation.engineOptions.tileSteps = tileSteps;
+    }
+    if (gpuSteps > 0) {
+        simulation.engineOptions.gpuSteps = gpuSteps;
+    }
+    std::string error;
+    if (not sweepList.empty() or not batchFile.empty()) {
+        // Every case comes with its own parameter file, or all cases come from one file
+        std::vector<Parameters> cases = not sweepList.empty() ? readSweepList(sweepList) : readParameterBatch(batchFile);
+        for (Parameters &c : cases) {
+            // As for a single run, the command line overrides the parameter files
+            if (not initial.empty()) {
+                c.initial = initial;
+            }
+            if (order > 0) {
+                c.order = order;
+            }
+            if (courant != 0.0) {
+                c.courant = courant;
+            }
+            deriveParameters(c);
+        }
+        if (not runSweep(std::move(cases), simulation, output, asyncBuffers, nthreads, sweepOutput, ensembleSize, error)) {
+            std::cerr << "Error: " << error << ".\n";
+            return 1;
+        }
+        std::cout << "Sweep results written.\n";
+        return 0;
+    }
+    if (paramfile.empty() and restartFile.empty()) {
         std::cerr << "Error: wave1d needs one parameter file argument.\n";
         return 1;
     }
-    if (not std::filesystem::exists(argv[1])) {
-        std::cerr << "Error: parameter file '" << argv[1] << "' not found.\n";
-        return 2;
+
+    Parameters param;
+    std::unique_ptr<Checkpoint> restart;
+    if (not restartFile.empty()) {
+        // The checkpoint holds the parameters and the state of the interrupted run
+        restart = std::make_unique<Checkpoint>(readCheckpoint(restartFile));
+        param = restart->param;
+        // A run continues as it started; a different engine, precision, initial wave or output would not
+        // give its results, so an option given again must match and the others come from the checkpoint
+        auto precisionText = [](int digits) { return (digits == shortestPrecision) ? std::string("shortest")
+                                                                                   : std::to_string(digits); };
+        auto regionText = [](const OutputRegion &r) { return valueText(r.xmin) + ":" + valueText(r.xmax); };
+        struct { const char* option; std::string given; std::string saved; } settings[] = {
+            {"--engine", engineName, param.engine},
+            {"--solver-precision", precisionName, param.precision},
+            {"--initial", initial, param.initial},
+            {"--format", output.format, restart->output.format},
+            {"--float32", output.float32 ? "yes" : "no", restart->output.float32 ? "yes" : "no"},
+            {"--precision", precisionText(output.precision), precisionText(restart->output.precision)},
+            {"--codec", output.codec, restart->output.codec},
+            {"--tolerance", valueText(output.tolerance), valueText(restart->output.tolerance)},
+            {"--compression-block", std::to_string(output.compressionBlock),
+                                    std::to_string(restart->output.compressionBlock)},
+            {"--field-every", std::to_string(fieldEvery), std::to_string(restart->fieldEvery)},
+            {"--region", regionText(region), regionText(restart->region)},
+            {"--stride", std::to_string(region.stride), std::to_string(restart->region.stride)}};
+        for (const auto &setting : settings) {
+            if (given.count(setting.option) > 0 and setting.given != setting.saved) {
+                std::cerr << "Error: " << setting.option << "=" << setting.given
+                          << " does not match the checkpointed run (" << setting.saved << ").\n";
+                return 1;
+            }
+        }
+        output.format           = restart->output.format;
+        output.float32          = restart->output.float32;
+        output.precision        = restart->output.precision;
+        output.codec            = restart->output.codec;
+        output.tolerance        = restart->output.tolerance;
+        output.compressionBlock = restart->output.compressionBlock;
+        region                  = restart->region;
+        fieldEvery              = restart->fieldEvery;
+
+        // Drop the output written after the checkpoint and continue the file from there
+        std::error_code error;
+        if (fieldEvery > 0) {
+            if (std::filesystem::file_size(param.outfilename, error) < restart->record.outputSize or error) {
+                std::cerr << "Error: output file '" << param.outfilename << "' is shorter than at the checkpoint.\n";
+                return 2;
+            }
+            std::filesystem::resize_file(param.outfilename, restart->record.outputSize);
+        }
+        output.resume = true;
+    } else {
+        if (not std::filesystem::exists(paramfile)) {
+            std::cerr << "Error: parameter file '" << paramfile << "' not found.\n";
+            return 2;
+        }
+
+        //Read file to save parameters in object of Parameters class
+        param = readFile(paramfile);
+        if (order > 0) {
+            param.order = order;
+        }
+        if (courant != 0.0) {
+            param.courant = courant;
+        }
+        if (param.courant <= 0.0 or param.courant > courantLimit(param.order)) {
+            std::cerr << "Error: the Courant number " << param.courant << " is not in (0, "
+                      << courantLimit(param.order) << "], where the order " << param.order
+                      << " stencil is stable.\n";
+            return 1;
+        }
+
+        //Find the dependent parameters from given parameters
+        deriveParameters(param);
+    }
+    if (not initial.empty()) {
+        param.initial = initial;
     }
-    
-    //Read file to save parameters in object of Parameters class
-    Parameters param = readFile(argv[1]);
 
-    //Find the dependent parameters from given parameters
-    deriveParameters(param);   
-   
-    // Open output file
-    std::ofstream fout(param.outfilename);
-
-    //Save parameters in first lines of the file
-    writeParameters(param, fout);
-    
-    // Define and allocate arrays
-    std::vector<double> x = initializeX(param);
-    std::vector<double> rho = initializeRho(param, x);
-    std::vector<double> rho_prev (rho);
+    if (not sweepC.empty() or not sweepTau.empty()) {
+        // Grid sweep over c and tau around the given parameters
+        std::vector<Parameters> cases;
+        ParameterError rejected;
+        if (not sweepGrid(param, sweepC, sweepTau, cases, rejected)) {
+            std::cerr << "Error: a case of the sweep is rejected: " << rejected.message << "\n";
+            return 1;
+        }
+        if (not runSweep(std::move(cases), simulation, output, asyncBuffers, nthreads, sweepOutput, ensembleSize, error)) {
+            std::cerr << "Error: " << error << ".\n";
+            return 1;
+        }
+        std::cout << "Sweep results written.\n";
+        return 0;
+    }
+    // Choose the stepping engine: the command line, then the parameter file, then the tuning options
+    if (engineName.empty() and param.engine.empty()) {
+        simulation.engine = (gpuSteps > 0) ? "gpu" : (tileSteps > 1) ? "tiled" : (nthreads >= 0) ? "threaded" : "serial";
+    }
+    simulation.engineOptions.nthreads = nthreads;
+    std::unique_ptr<Simulation> sim = Simulation::create(param, simulation, error);
+    if (not sim) {
+        std::cerr << "Error: " << error << ".\n";
+        return 1;
+    }
    
-    // Output initial wave to file
-    fout << "\n#t = " << 0.0 << "\n";
-    printX(fout, rho, x, param);
+    // The full snapshots may be sparser than the samples of the analysis
+    Parameters fieldParam = param;
+    fieldParam.nper = param.nper*fieldEvery;
+    fieldParam.outtime = param.outtime*static_cast<double>(fieldEvery);
+
+    // Open output file in the requested format
+    std::unique_ptr<SnapshotWriter> writer;
+    if (fieldEvery > 0) {
+        writer = makeSnapshotWriter(output, param.outfilename);
+        if (not writer) {
+            std::cerr << "Error: unknown output format '" << output.format << "' or codec '" << output.codec
+                      << "' (the lossy codec needs a positive --tolerance).\n";
+            return 1;
+        }
+    }
+    // Write on a background thread, with at most asyncBuffers snapshots in flight
+    writer = writeInBackground(std::move(writer), output.format, asyncBuffers);
+    AsyncSnapshotWriter* asyncWriter = dynamic_cast<AsyncSnapshotWriter*>(writer.get());
+    if (writer and not region.whole()) {
+        if (regionPoints(region, sim->grid()) == 0) {
+            std::cerr << "Error: no grid point lies in the output region [" << region.xmin << ", "
+                      << region.xmax << "].\n";
+            return 1;
+        }
+        // Gather the points straight into the buffers of the asynchronous writer, so only they are copied
+        writer = std::make_unique<RegionSnapshotWriter>(std::move(writer), region);
+    }
 
-    // Take timesteps
-    for (size_t s = 0; s < param.nsteps; s++) {
-        //Find next iteration of the wave
-        std::vector<double> rho_next = timeStep(rho, rho_prev, param);
+#ifdef WAVE1D_PROFILE
+    if (counters and not enableCounters()) {
+        std::cerr << "Warning: hardware counters are not available, timing phases only.\n";
+    }
+#endif
 
-        // Update arrays such that t+1 becomes the new t etc.
-        std::swap(rho_prev, rho);
-        std::swap(rho, rho_next);
-        
-        // Output wave to file
-        if ((s+1)%param.nper == 0) {
-            fout << "\n\n# t = " << static_cast<double>(s+1)*param.dt << "\n";
-            printX(fout, rho, x, param);
+    const UniformGrid &x = sim->grid();
+    size_t firstStep = 0;
+    size_t nsnapshots = 0;                    // snapshots in the output file
+
+    //Save parameters (and the grid) in front of the snapshots
+    if (writer) {
+        writer->writeHeader(fieldParam, x);
+    }
+
+    std::unique_ptr<AccuracyReport> accuracy;
+    if (not referenceFile.empty()) {
+        accuracy = std::make_unique<AccuracyReport>(referenceFile, param);
+    }
+    if (restart) {
+        // Carry on from the checkpoint; the simulation does not pass its state to the callbacks again
+        firstStep = restart->record.step;
+        nsnapshots = restart->record.nsnapshots;
+        if (writer) {
+            writer->resume(restart->record.outputSize, nsnapshots);
         }
+        if (accuracy) {
+            accuracy->compare(firstStep, restart->rho);
+        }
+        sim->resume(std::move(restart->rho), std::move(restart->rho_prev), firstStep);
+        restart.reset();
     }
 
-    // Close file
-    fout.close();
-    std::cout << "Results written to '"<< param.outfilename << "'.\n";
+    // Reduce the wave at every snapshot time
+    std::unique_ptr<InSituAnalysis> analysis;
+    if (not reductions.empty()) {
+        analysis = std::make_unique<InSituAnalysis>(seriesFile.empty() ? param.outfilename + ".series" : seriesFile,
+                                                    reductions, param, x, firstStep);
+        sim->onSnapshot([&analysis](size_t step, const Field &wave, const Field &previous) {
+            analysis->sample(step, wave, previous);
+        });
+    }
+    if (accuracy) {
+        sim->onSnapshot([&accuracy](size_t step, const Field &wave, const Field &) {
+            accuracy->compare(step, wave);
+        });
+    }
+    // Output the initial wave and every fieldEvery-th sample to file
+    if (writer) {
+        sim->onSnapshot([&](size_t step, const Field &wave, const Field &) {
+            if (step%fieldParam.nper == 0) {
+                writer->writeSnapshot(step, wave);
+                nsnapshots++;
+            }
+        });
+    }
+
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (checkpointEvery > 0) {
+        checkpoints = std::make_unique<CheckpointWriter>(
+            checkpointFile.empty() ? param.outfilename + ".ckpt" : checkpointFile, sim->parameters(), output, region,
+            fieldEvery);
+    }
+
+    // Take timesteps, outputting the wave after the given number of steps
+    {
+        std::unique_ptr<ProgressReporter> reporter;
+        if (not progress.empty()) {
+            reporter = std::make_unique<ProgressReporter>(progress, progressInterval, param, sim->engine().progress(),
+                sim->step(), [asyncWriter]() -> size_t { return asyncWriter ? asyncWriter->queueDepth() : 0; });
+        }
+        PROFILE_SCOPE(run);
+        do {
+            // Stop at every checkpoint step on the way
+            size_t s = sim->step();
+            if (not sim->advance((checkpointEvery > 0) ? (s/checkpointEvery + 1)*checkpointEvery : param.nsteps)) {
+                std::cerr << "Error: " << sim->error() << ".\n";
+                return 1;
+            }
+            if (checkpoints and not sim->finished()) {
+                checkpoints->save(sim->engine(), sim->step(), writer ? writer->flush() : 0, nsnapshots);
+            }
+        } while (not sim->finished());
+    }
+    checkpoints.reset();
+
+    if (accuracy) {
+        accuracy->print(std::cout);
+    }
+
+    // Close files
+    if (analysis) {
+        analysis->close();
+        std::cout << "Reductions written to '" << (seriesFile.empty() ? param.outfilename + ".series" : seriesFile)
+                  << "'.\n";
+    }
+    if (writer) {
+        writer->close();
+        std::cout << "Results written to '"<< param.outfilename << "'.\n";
+    }
+
+#ifdef WAVE1D_PROFILE
+    double pointSteps = static_cast<double>(param.nsteps - firstStep)*static_cast<double>(param.ngrid);
+    if (profileFile.empty()) {
+        profileReport(std::cerr, pointSteps);
+    } else {
+        if (profileFile == "-") {
+            profileFile = param.outfilename + ".profile";
+        }
+        std::ofstream profile(profileFile);
+        profileReport(profile, pointSteps);
+        std::cout << "Profile written to '" << profileFile << "'.\n";
+    }
+#endif
 }
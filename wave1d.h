@@ -2,7 +2,15 @@
 #define WAVE1_H
 
 #include <fstream>
+#include <ostream>
+#include <string>
 #include <vector>
+#include "alignedAllocator.h"
+
+class StencilKernel;
+
+// a field of values on the grid, aligned for the vectorized kernels
+using Field = std::vector<double, AlignedAllocator<double>>;
 
 // create a type that will hold a collection of parameters
 class Parameters {
@@ -15,6 +23,11 @@ class Parameters {
     double  dx;             // spatial grid size
     double  outtime;        // how often should a snapshot of the wave be written out? 
     std::string outfilename;// name of the file with the output data
+    std::string engine;     // optional stepping engine, see steppingEngine.h; empty leaves it to the command line
+    std::string precision;  // optional float64, float32 or mixed, see steppingEngine.h; empty leaves it to the command line
+    std::string initial;    // optional shape of the initial wave, see initialCondition.h; empty is the triangle
+    size_t  order = 2;      // spatial order of accuracy of the stencil, 2, 4 or 6, see stencilKernel.h
+    double  courant = 0.5;  // Courant number c*dt/dx, at most courantLimit(order)
     // the remainder are to be derived from the above ones:
     size_t  ngrid;          // number of x points
     double  dt;             // time step size
@@ -22,26 +35,89 @@ class Parameters {
     size_t  nper;           // how many step s between snapshots
 };
 
+//The x values of an evenly spaced grid, computed when asked for instead of stored. Point i of the grid
+//is point first + i*stride of the whole grid from x1 to x2, whose values are
+//    x1 + (j*(x2-x1))/(ngrid-1)
+//so a part of the grid gives exactly the same values as the whole. Copies are cheap.
+class UniformGrid {
+  public:
+    UniformGrid(const Parameters &param, size_t begin, size_t end);
+
+    double operator[](size_t i) const {
+        return x1 + (static_cast<double>(first + i*stride)*width)/denominator;
+    }
+
+    //Writes the values of the points begin..end-1 to out, in a loop that vectorizes: the index is split into
+    //a base converted once and an int offset, whose sum is exact. Needs (end-begin)*stride < 2^31.
+    void values(size_t begin, size_t end, double *out) const {
+        const double base = static_cast<double>(first + begin*stride);
+        const double left = x1, length = width, divisor = denominator;
+        const int step = static_cast<int>(stride);
+        const int n = static_cast<int>(end - begin);
+        #pragma omp simd
+        for (int k = 0; k < n; k++) {
+            out[k] = left + ((base + static_cast<double>(k*step))*length)/divisor;
+        }
+    }
+    size_t size() const { return count; }
+
+    //The points begin, begin+stride, ... below end of this grid
+    UniformGrid subset(size_t begin, size_t end, size_t stride) const;
+
+    //Index of the first point with x >= value, and with x > value (size() if there is none)
+    size_t lowerBound(double value) const;
+    size_t upperBound(double value) const;
+
+  private:
+    double x1;
+    double width;           // x2-x1
+    double denominator;     // ngrid-1 of the whole grid
+    size_t first;
+    size_t stride;
+    size_t count;
+};
+
 //Reads the file given as an argument and gives back the set of parameters
-Parameters readFile(std::string filename);
+Parameters readFile(const std::string &filename);
+
+//Writes the Parameters given by first argument into a given file (or other stream) given by the second argument
+void writeParameters(const Parameters &param, std::ostream &fout);
+
+//Gives the grid of x values according to given Parameters
+UniformGrid initializeX(const Parameters &param);
 
-//Writes the Parameters given by first argument into a given file given by the second argument
-void writeParameters(Parameters &param, std::ofstream &fout);
+//Gives the x values of the grid points begin..end-1 only, e.g. for the part of the grid owned by one process
+UniformGrid initializeX(const Parameters &param, size_t begin, size_t end);
 
-//Initialize array of x values according to given Parameters
-std::vector<double> initializeX(Parameters param);
+//Initialize wave with a triangle shape from xstart to xfinish, at each of the given x values
+Field initializeRho(const Parameters &param, const UniformGrid &x);
 
-//Initialize wave with a triangle shape from xstart to xfinish
-std::vector<double> initializeRho(Parameters param, std::vector<double> x);
+//Gives the wave one time step before the initial wave rho, the second time level the leap-frog update starts
+//from. For the stencil of order 2 this is rho itself, as it always was; the higher orders take a Taylor step
+//of second order back in time instead (for a wave at rest), or the error of the start would dominate theirs.
+Field previousLevel(const StencilKernel &kernel, const Field &rho);
 
 //Writes the rho values in dependence of the x values into a given file
-void printX(std::ofstream &fout, std::vector<double> rho, std::vector<double> x, Parameters param);
+void printX(std::ostream &fout, const Field &rho, const UniformGrid &x, const Parameters &param);
 
-//Calculates the next approximation of the wave function.
-//Sets zero Dirichlet boundary conditions and evolves inner region over a time dt using a leap-frog variant
-std::vector<double> timeStep(std::vector<double> &rho, std::vector<double> &rho_prev, Parameters param);
+//Calculates the next approximation of the wave function and stores it in the caller-owned rho_next.
+//Sets zero Dirichlet boundary conditions and evolves inner region over a time dt using a leap-frog variant.
+//All three arrays must hold param.ngrid values; no memory is allocated.
+void timeStep(Field &rho, const Field &rho_prev, Field &rho_next, const Parameters &param);
+
+//Same as above, with the stencil coefficients precomputed once in the given kernel.
+//The inner region is evolved with the stencil implementation chosen by selectSimdLevel.
+void timeStep(Field &rho, const Field &rho_prev, Field &rho_next, const StencilKernel &kernel);
+
+//Rotates the three time levels after a call to timeStep such that t+1 becomes the new t etc.
+//Only the buffers are exchanged, the values are not copied.
+void rotateBuffers(Field &rho_prev, Field &rho, Field &rho_next);
 
 //Derive dependent paramters from parameters that were previously read out from a file
 void deriveParameters(Parameters &param);
 
+//Largest Courant number at which the leap-frog update with the stencil of the given order (2, 4 or 6) is
+//stable: 1, sqrt(3/4) = 0.866 and sqrt(45/68) = 0.8135; 0 for other orders
+double courantLimit(size_t order);
+
 #endif
@@ -0,0 +1,164 @@
+// wave1d_mpi.cpp - Simulates a one-dimensional damped wave equation on several MPI processes
+//
+// The grid is split into contiguous blocks, one per rank. Each rank keeps one halo cell on either side,
+// which is exchanged with its neighbours every step while the rest of the block is being updated.
+// Snapshots are written with collective MPI-IO, every rank writing its own part of the file.
+//
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <filesystem>
+#include <vector>
+#include <mpi.h>
+#include "wave1d.h"
+#include "stencilKernel.h"
+#include "simdKernels.h"
+
+//Writes the text produced by each rank into consecutive parts of the file at the given offset,
+//in rank order, and advances the offset past all of it
+static void writeOrdered(MPI_File fh, MPI_Offset &offset, const std::string &text){
+    long long length = static_cast<long long>(text.size());
+    long long before = 0;
+    long long total = 0;
+    MPI_Exscan(&length, &before, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&length, &total, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        before = 0;  // MPI_Exscan leaves the result on rank 0 undefined
+    }
+    MPI_File_write_at_all(fh, offset + before, text.data(), static_cast<int>(length), MPI_CHAR, MPI_STATUS_IGNORE);
+    offset += total;
+}
+
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Check command line argument
+    if (argc != 2) {
+        if (rank == 0) {
+            std::cerr << "Error: wave1d_mpi needs one parameter file argument.\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (not std::filesystem::exists(argv[1])) {
+        if (rank == 0) {
+            std::cerr << "Error: parameter file '" << argv[1] << "' not found.\n";
+        }
+        MPI_Finalize();
+        return 2;
+    }
+
+    //Read file to save parameters in object of Parameters class, and find the dependent parameters
+    Parameters param = readFile(argv[1]);
+    deriveParameters(param);
+    if (param.order > 2) {
+        // The halos hold one point, enough for the three point stencil only
+        if (rank == 0) {
+            std::cerr << "Error: wave1d_mpi only steps the order 2 stencil.\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    StencilKernel kernel(param);
+
+    // Decompose the grid: rank r owns the global points first..last-1
+    const size_t ngrid = param.ngrid;
+    const size_t urank = static_cast<size_t>(rank);
+    const size_t usize = static_cast<size_t>(size);
+    const size_t first = urank*ngrid/usize;
+    const size_t last = (urank+1)*ngrid/usize;
+    const size_t nlocal = last - first;
+    const int left = (rank > 0) ? rank-1 : MPI_PROC_NULL;
+    const int right = (rank < size-1) ? rank+1 : MPI_PROC_NULL;
+
+    // Local arrays hold the owned points at 1..nlocal and a halo cell at 0 and nlocal+1
+    UniformGrid x = initializeX(param, first, last);
+    Field owned = initializeRho(param, x);
+    Field rho (nlocal+2, 0);
+    std::copy(owned.begin(), owned.end(), rho.begin()+1);
+    Field rho_prev (rho);
+    Field rho_next (nlocal+2, 0);
+
+    // Zero Dirichlet boundary conditions, applied only on the edge ranks and never overwritten
+    const size_t lo = (first == 0) ? 2 : 1;                    // first local point to update
+    const size_t hi = (last == ngrid) ? nlocal : nlocal+1;     // one past the last local point to update
+    if (first == 0) {
+        rho[1] = rho_prev[1] = rho_next[1] = 0.0;
+    }
+    if (last == ngrid) {
+        rho[nlocal] = rho_prev[nlocal] = rho_next[nlocal] = 0.0;
+    }
+
+    // Open output file collectively, truncating any existing one
+    MPI_File fh;
+    MPI_File_open(MPI_COMM_WORLD, param.outfilename.c_str(), MPI_MODE_CREATE|MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+    MPI_File_set_size(fh, 0);
+    MPI_Offset offset = 0;
+
+    // Each snapshot is formatted locally, rank 0 adds the time line in front
+    std::ostringstream text;
+    auto snapshot = [&](const std::string &heading) {
+        text.str("");
+        if (rank == 0) {
+            text << heading;
+        }
+        for (size_t i = 0; i < nlocal; i++) {
+            text << x[i] << " " << rho[i+1] << "\n";
+        }
+        writeOrdered(fh, offset, text.str());
+    };
+
+    // Parameters and initial wave
+    std::ostringstream heading;
+    writeParameters(param, heading);
+    heading << "\n#t = " << 0.0 << "\n";
+    snapshot(heading.str());
+
+    // Take timesteps
+    for (size_t s = 0; s < param.nsteps; s++) {
+        // Start the halo exchange
+        MPI_Request requests[4];
+        MPI_Irecv(&rho[0], 1, MPI_DOUBLE, left, 0, MPI_COMM_WORLD, &requests[0]);
+        MPI_Irecv(&rho[nlocal+1], 1, MPI_DOUBLE, right, 1, MPI_COMM_WORLD, &requests[1]);
+        MPI_Isend(&rho[1], 1, MPI_DOUBLE, left, 1, MPI_COMM_WORLD, &requests[2]);
+        MPI_Isend(&rho[nlocal], 1, MPI_DOUBLE, right, 0, MPI_COMM_WORLD, &requests[3]);
+
+        // Update the points that do not need the halo while the messages are in flight
+        if (nlocal > 2) {
+            applyStencilRange(kernel, rho.data(), rho_prev.data(), rho_next.data(), 2, nlocal);
+        }
+        MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+
+        // Then the points next to the halo
+        if (lo == 1) {
+            applyStencilRange(kernel, rho.data(), rho_prev.data(), rho_next.data(), 1, 2);
+        }
+        if (hi == nlocal+1 and nlocal > 1) {
+            applyStencilRange(kernel, rho.data(), rho_prev.data(), rho_next.data(), nlocal, nlocal+1);
+        }
+
+        // Update arrays such that t+1 becomes the new t etc.
+        rotateBuffers(rho_prev, rho, rho_next);
+
+        // Output wave to file
+        if ((s+1)%param.nper == 0) {
+            std::ostringstream line;
+            line << "\n\n# t = " << static_cast<double>(s+1)*param.dt << "\n";
+            snapshot(line.str());
+        }
+    }
+
+    // Close file
+    MPI_File_close(&fh);
+    if (rank == 0) {
+        std::cout << "Results written to '"<< param.outfilename << "'.\n";
+    }
+    MPI_Finalize();
+}
@@ -1,63 +1,195 @@
 //waveModule.cpp
 //
 //Defines the functions that are used to solve the waveequation
+#include <algorithm>
 #include <cmath>
 #include <vector>
-#include <cmath>
-#include <vector>
+#include <utility>
 #include "wave1d.h"
+#include "stencilKernel.h"
+#include "simdKernels.h"
+#include "phaseProfiler.h"
+#include "threadedStepping.h"
+
+
+UniformGrid::UniformGrid(const Parameters &param, size_t begin, size_t end)
+  : x1(param.x1), width(param.x2-param.x1), denominator(static_cast<double>(param.ngrid-1)),
+    first(begin), stride(1), count(end-begin)
+{}
+
+UniformGrid UniformGrid::subset(size_t begin, size_t end, size_t stride) const{
+    UniformGrid part = *this;
+    part.first = first + begin*this->stride;
+    part.stride = this->stride*stride;
+    part.count = (end > begin) ? (end - begin + stride - 1)/stride : 0;
+    return part;
+}
+
+size_t UniformGrid::lowerBound(double value) const{
+    //Binary search on the computed values, which increase with the index
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = low + (high-low)/2;
+        if ((*this)[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+size_t UniformGrid::upperBound(double value) const{
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = low + (high-low)/2;
+        if (not (value < (*this)[mid])) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
 
+UniformGrid initializeX(const Parameters &param){
+    return initializeX(param, 0, param.ngrid);
+};
 
-std::vector<double> initializeX(Parameters param){
-    std::vector<double> x (param.ngrid, 0); 
-    
-    //Calculate an even distribution of x values between first and last point
-    for (size_t i = 0; i < param.ngrid; i++) {
-        x[i] = (param.x1 + (static_cast<double>(i)*(param.x2-param.x1))/static_cast<double>(param.ngrid-1));
-    } 
-    return x;
+UniformGrid initializeX(const Parameters &param, size_t begin, size_t end){
+    //An even distribution of x values between first and last point, computed where it is needed
+    return UniformGrid(param, begin, end);
 };
 
 void deriveParameters(Parameters &param){
     param.ngrid  = static_cast<size_t>((param.x2-param.x1)/param.dx);// number of x points (rounded down)
-    param.dt     = 0.5*param.dx/param.c;                             // time step size
+    param.dt     = param.courant*param.dx/param.c;                   // time step size
     param.nsteps = static_cast<size_t>(param.runtime/param.dt);      // number of steps to reach runtime (rounded down)
     param.nper   = static_cast<size_t>(param.outtime/param.dt);      // how many steps between snapshots (rounded down)
 };
 
 
 
-std::vector<double> initializeRho(Parameters param, std::vector<double> x){
-    std::vector<double> rho (param.ngrid, 0);
-    double xstart = 0.25*(param.x2-param.x1) + param.x1;
-    double xmid = 0.5*(param.x2+param.x1);
-    double xfinish = 0.75*(param.x2-param.x1) + param.x1;
-
-    //Calculates a triangle wave in between xstart and xstop
-    for (size_t i = 0; i < param.ngrid; i++) {
-        if (x[i] < xstart or x[i] > xfinish) {
-            rho[i] = 0.0;
-        } else {
-            rho[i] =  0.25 - fabs(x[i]-xmid)/(param.x2-param.x1);
+//Calculates a triangle wave in between xstart and xstop at the points begin..end-1, a block of x values at
+//a time and selecting instead of branching, so both loops vectorize
+WAVE1D_TARGET_CLONES
+static void triangleRange(const Parameters &param, const UniformGrid &x, double *rho, size_t begin, size_t end){
+    const double xstart = 0.25*(param.x2-param.x1) + param.x1;
+    const double xmid = 0.5*(param.x2+param.x1);
+    const double xfinish = 0.75*(param.x2-param.x1) + param.x1;
+    const double width = param.x2-param.x1;
+    double xs[512];
+    for (size_t block = begin; block < end; block += 512) {
+        const size_t n = std::min<size_t>(512, end - block);
+        x.values(block, block + n, xs);
+        double* values = rho + block;
+        #pragma omp simd
+        for (size_t i = 0; i < n; i++) {
+            double triangle = 0.25 - fabs(xs[i]-xmid)/width;
+            bool outside = (xs[i] < xstart) | (xs[i] > xfinish);
+            values[i] = outside ? 0.0 : triangle;
         }
     }
+}
+
+Field initializeRho(const Parameters &param, const UniformGrid &x){
+    Field rho (x.size());   // left uninitialized, each thread touches its part first
+    forEachThreadChunk(x.size(), 0, [&](size_t begin, size_t end) {
+        triangleRange(param, x, rho.data(), begin, end);
+    });
     return rho;
 };
 
-std::vector<double> timeStep(std::vector<double> &rho, std::vector<double> &rho_prev, Parameters param){
-        std::vector<double> rho_next(param.ngrid, 0);   
+StencilKernel::StencilKernel(const Parameters &param){
+    // The grid points are (x2-x1)/(ngrid-1) apart, slightly more than dx since ngrid is rounded down. The
+    // second order stencil keeps using dx, as it always has; the higher orders would hardly gain from their
+    // smaller truncation error if the wave speed were off by a relative 1/ngrid.
+    double spacing  = (param.order > 2) ? (param.x2 - param.x1)/static_cast<double>(param.ngrid - 1) : param.dx;
+    double courant  = param.c*param.dt/spacing;
+    double friction = param.dt/param.tau;
+    k = courant*courant;
+    a = 2.0 - 2.0*k - friction;
+    b = friction - 1.0;
+    ngrid = param.ngrid;
+    order = param.order;
+
+    // Central differences of the second derivative of order 2, 4 and 6 at the distances 0..3
+    const double differences[3][4] = {{-2.0, 1.0, 0.0, 0.0},
+                                      {-5.0/2.0, 4.0/3.0, -1.0/12.0, 0.0},
+                                      {-49.0/18.0, 3.0/2.0, -3.0/20.0, 1.0/90.0}};
+    for (size_t n = 0; n < 3; n++) {
+        weights[n][0] = 2.0 - friction + k*differences[n][0];
+        for (size_t j = 1; j < 4; j++) {
+            weights[n][j] = k*differences[n][j];
+        }
+    }
+    // Exactly the coefficients of the three point stencil
+    weights[0][0] = a;
+}
+
+double courantLimit(size_t order){
+    // The wave of the shortest wave length on the grid must stay bounded: courant^2 times the largest
+    // eigenvalue of the second difference, 4, 16/3 and 272/45, may not exceed 4
+    switch (order) {
+        case 2:  return 1.0;
+        case 4:  return std::sqrt(3.0/4.0);
+        case 6:  return std::sqrt(45.0/68.0);
+        default: return 0.0;
+    }
+}
+
+bool StencilKernel::damped() const{
+    return b != -1.0;
+}
+
+Field previousLevel(const StencilKernel &kernel, const Field &rho){
+    Field rho_prev(rho);
+    if (kernel.order <= 2) {
+        return rho_prev;
+    }
+    // rho - dt*rho_t + dt^2/2*rho_tt with rho_t = 0 and rho_tt = c^2 rho_xx, where dt^2 c^2 rho_xx is the
+    // stencil of the kernel without its time levels: sum_j w[j]*(rho[i-j] + rho[i+j]) + (w[0] - 1 + b)*rho[i]
+    const size_t ngrid = kernel.ngrid;
+    const size_t half = kernel.order/2;
+    for (size_t i = 1; i + 1 < ngrid; i++) {
+        const size_t reach = std::min(std::min(i, ngrid - 1 - i), half);
+        const double *w = kernel.weights[reach-1];
+        double difference = (w[0] - 1.0 + kernel.b)*rho[i];
+        for (size_t j = 1; j <= reach; j++) {
+            difference += w[j]*(rho[i-j] + rho[i+j]);
+        }
+        rho_prev[i] = rho[i] + 0.5*difference;
+    }
+    return rho_prev;
+}
+
+void timeStep(Field &rho, const Field &rho_prev, Field &rho_next, const Parameters &param){
+    timeStep(rho, rho_prev, rho_next, StencilKernel(param));
+}
 
+void timeStep(Field &rho, const Field &rho_prev, Field &rho_next, const StencilKernel &kernel){
+        PROFILE_SCOPE(step);
         // Set zero Dirichlet boundary conditions
         rho[0] = 0.0;
-        rho[param.ngrid-1] = 0.0;
+        rho[kernel.ngrid-1] = 0.0;
+        rho_next[0] = 0.0;
+        rho_next[kernel.ngrid-1] = 0.0;
 
-        // Evolve inner region over a time dt using a leap-frog variant
-        for (size_t i = 1; i <= param.ngrid-2; i++) {
-            double laplacian = pow(param.c/param.dx,2)*(rho[i+1] + rho[i-1] - 2*rho[i]);
-            double friction = (rho[i] - rho_prev[i])/param.tau;
-            rho_next[i] = 2*rho[i] - rho_prev[i] + param.dt*(laplacian*param.dt-friction);
+        // Evolve inner region over a time dt using a leap-frog variant. An undamped second order kernel
+        // (infinite tau) or one on the grid size fixedStencilSize uses its compile-time instance.
+        if (kernel.order <= 2 and not kernel.damped()) {
+            applyStencil<false>(kernel, rho.data(), rho_prev.data(), rho_next.data());
+        } else if (kernel.order <= 2 and kernel.ngrid == fixedStencilSize) {
+            applyStencil<true, fixedStencilSize>(kernel, rho.data(), rho_prev.data(), rho_next.data());
+        } else {
+            applyStencilRange(kernel, rho.data(), rho_prev.data(), rho_next.data(), 1, kernel.ngrid-1);
         }
-        return rho_next;
 }
 
-
+void rotateBuffers(Field &rho_prev, Field &rho, Field &rho_next){
+    // Swapping vectors only exchanges their internal pointers
+    std::swap(rho_prev, rho);
+    std::swap(rho, rho_next);
+}